@@ -0,0 +1,208 @@
+#include "CovarianceCache.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr std::array<char, 8> MAGIC { 'M', 'C', 'V', 'A', 'R', 'C', 'O', 'V' };
+    constexpr std::uint32_t VERSION { 2 };
+    constexpr const char* FILE_PREFIX { "covariance_" };
+    constexpr const char* FILE_SUFFIX { ".cache" };
+
+    // fixed-size header: the doubles that follow stay 8-byte aligned
+    struct CacheHeader
+    {
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t reserved;
+        std::uint64_t fingerprint;
+        std::uint64_t asset_count;
+    };
+
+    // header, then mean (N), covariance (N x N) and Cholesky factor (N x N), column-major
+    std::size_t fileSize(const std::size_t n_assets)
+    {
+        return sizeof(CacheHeader) + (n_assets + 2 * n_assets * n_assets) * sizeof(double);
+    }
+
+    constexpr std::uint64_t HASH_SEED { 0x9E3779B97F4A7C15ull };
+
+    // splitmix64 finalizer: every input bit flips about half of the output bits
+    std::uint64_t mix64(std::uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // one word at a time, chained: the order of the words matters and a difference in any bit reaches the whole hash
+    std::uint64_t hashWords(std::uint64_t hash, const void* data, const std::size_t word_count)
+    {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < word_count; ++i)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + i * sizeof(word), sizeof(word));
+            hash = mix64(hash ^ mix64(word + HASH_SEED));
+        }
+        return hash;
+    }
+}
+
+CovarianceCache::CovarianceCache(std::string directory, const std::size_t max_files)
+    : s_directory{std::move(directory)}
+    , i_max_files{std::max<std::size_t>(1, max_files)}
+{
+}
+
+// getters
+const std::string& CovarianceCache::getDirectory() const
+{
+    return s_directory;
+}
+std::size_t CovarianceCache::getMaxFiles() const
+{
+    return i_max_files;
+}
+
+std::string CovarianceCache::filePath(const std::uint64_t fingerprint) const
+{
+    char name[40];
+    std::snprintf(name, sizeof(name), "%s%016llx%s", FILE_PREFIX, static_cast<unsigned long long>(fingerprint), FILE_SUFFIX);
+    return s_directory.empty() ? std::string(name) : s_directory + "/" + name;
+}
+
+std::uint64_t CovarianceCache::fingerprint(const Eigen::Ref<const Eigen::MatrixXd>& returns, const double annualization)
+{
+    const std::array<std::uint64_t, 3> dimensions { static_cast<std::uint64_t>(returns.rows()), static_cast<std::uint64_t>(returns.cols()), VERSION };
+
+    std::uint64_t hash = HASH_SEED;
+    hash = hashWords(hash, dimensions.data(), dimensions.size());
+    hash = hashWords(hash, &annualization, 1);
+    // column by column: a strided view (e.g. a MarketDataStore) hashes like the same values in a dense matrix
+    for (Eigen::Index j = 0; j < returns.cols(); ++j)
+    {
+        hash = hashWords(hash, returns.col(j).data(), static_cast<std::size_t>(returns.rows()));
+    }
+    return hash;
+}
+
+std::optional<CovarianceEstimate> CovarianceCache::load(const std::uint64_t fingerprint, const Eigen::Index asset_count) const
+{
+    const std::string path = filePath(fingerprint);
+    MappedFile file;
+    try
+    {
+        file = MappedFile(path);
+    } catch (const std::runtime_error&) {
+        return std::nullopt;
+    }
+
+    // a file from another version, another input or a truncated write is ignored: it will be overwritten
+    CacheHeader header{};
+    if (file.size() < sizeof(header))
+    {
+        return std::nullopt;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION || header.fingerprint != fingerprint
+        || header.asset_count != static_cast<std::uint64_t>(asset_count) || file.size() != fileSize(static_cast<std::size_t>(header.asset_count)))
+    {
+        return std::nullopt;
+    }
+
+    const auto n = static_cast<Eigen::Index>(header.asset_count);
+    const auto* values = reinterpret_cast<const double*>(file.data() + sizeof(header));
+
+    CovarianceEstimate estimate;
+    estimate.mean = Eigen::Map<const Eigen::VectorXd>(values, n);
+    estimate.covariance = Eigen::Map<const Eigen::MatrixXd>(values + n, n, n);
+    estimate.cholesky_lower = Eigen::Map<const Eigen::MatrixXd>(values + n + n * n, n, n);
+
+    // the eviction removes the least recently used files: a hit counts as a use
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    return estimate;
+}
+
+void CovarianceCache::store(const std::uint64_t fingerprint, const CovarianceEstimate& estimate) const
+{
+    const Eigen::Index n = estimate.mean.size();
+    if (estimate.covariance.rows() != n || estimate.covariance.cols() != n || estimate.cholesky_lower.rows() != n || estimate.cholesky_lower.cols() != n)
+    {
+        throw std::invalid_argument("CovarianceCache: mean, covariance and Cholesky factor have different numbers of assets.");
+    }
+
+    const std::string path = filePath(fingerprint);
+    const std::string temporary_path = path + ".tmp";
+    {
+        MappedFile file = MappedFile::create(temporary_path, fileSize(static_cast<std::size_t>(n)));
+
+        const CacheHeader header{ MAGIC, VERSION, 0, fingerprint, static_cast<std::uint64_t>(n) };
+        std::memcpy(file.writableData(), &header, sizeof(header));
+
+        auto* values = reinterpret_cast<double*>(file.writableData() + sizeof(header));
+        Eigen::Map<Eigen::VectorXd>(values, n) = estimate.mean;
+        Eigen::Map<Eigen::MatrixXd>(values + n, n, n) = estimate.covariance;
+        Eigen::Map<Eigen::MatrixXd>(values + n + n * n, n, n) = estimate.cholesky_lower;
+        file.flush();
+    }
+
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary_path.c_str());
+        throw std::runtime_error("CovarianceCache: can't write " + path);
+    }
+    evict(path);
+}
+
+void CovarianceCache::evict(const std::string& keep_path) const
+{
+    namespace fs = std::filesystem;
+
+    // a file that can't be listed or removed stays: the cache only costs disk space, never correctness
+    std::error_code error;
+    std::vector<std::pair<fs::file_time_type, fs::path>> files;
+    for (fs::directory_iterator it(s_directory.empty() ? "." : s_directory, error), end; !error && it != end; it.increment(error))
+    {
+        const std::string name = it->path().filename().string();
+        if (name.size() > std::strlen(FILE_PREFIX) + std::strlen(FILE_SUFFIX) && name.starts_with(FILE_PREFIX) && name.ends_with(FILE_SUFFIX))
+        {
+            std::error_code time_error;
+            const fs::file_time_type time = fs::last_write_time(it->path(), time_error);
+            if (!time_error)
+            {
+                files.emplace_back(time, it->path());
+            }
+        }
+    }
+    if (files.size() <= i_max_files)
+    {
+        return;
+    }
+
+    // most recently used first: the file just written is kept whatever its time stamp
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    std::size_t kept = 1;
+    for (const auto& [time, file] : files)
+    {
+        if (fs::equivalent(file, keep_path, error))
+        {
+            continue;
+        }
+        if (kept < i_max_files)
+        {
+            ++kept;
+        } else {
+            fs::remove(file, error);
+        }
+    }
+}
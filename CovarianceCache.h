@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <Eigen/Dense>
+
+// Mean, annualized covariance and its lower Cholesky factor estimated from a return matrix
+struct CovarianceEstimate
+{
+    Eigen::VectorXd mean;
+    Eigen::MatrixXd covariance;
+    Eigen::MatrixXd cholesky_lower;
+};
+
+// On-disk cache of the covariance estimates, one file per fingerprint of the inputs in the cache directory
+// A rerun on unchanged data maps the file and copies the matrices instead of redoing the O(n * N^2 + N^3) work.
+// The files are written to a temporary name and renamed, so a reader never sees a partial file.
+// The files are N^2-sized: only the max_files most recently used ones are kept, the others are removed by store()
+class CovarianceCache
+{
+private:
+    std::string s_directory;
+    std::size_t i_max_files{};
+
+    std::string filePath(std::uint64_t fingerprint) const;
+    // remove the least recently used files beyond i_max_files, never keep_path
+    void evict(const std::string& keep_path) const;
+public:
+    explicit CovarianceCache(std::string directory, std::size_t max_files = 4);
+
+    // getters
+    const std::string& getDirectory() const;
+    std::size_t getMaxFiles() const;
+
+    // 64-bit hash of the dimensions, the values of the return matrix and the estimation parameters: every 64-bit word
+    // goes through the splitmix64 finalizer, so a change of any bit (sign and exponent included) changes the whole key
+    static std::uint64_t fingerprint(const Eigen::Ref<const Eigen::MatrixXd>& returns, double annualization);
+
+    // the cached estimate, or nothing if there is no valid file for this fingerprint and number of assets
+    // a hit marks the file as recently used
+    std::optional<CovarianceEstimate> load(std::uint64_t fingerprint, Eigen::Index asset_count) const;
+    // throws std::runtime_error if the file can't be written
+    void store(std::uint64_t fingerprint, const CovarianceEstimate& estimate) const;
+};
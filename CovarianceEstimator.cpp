@@ -0,0 +1,310 @@
+#include "CovarianceEstimator.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // columns of a tile: a tile pair of the covariance is TILE x TILE doubles (128 KB)
+    constexpr Eigen::Index TILE { 128 };
+    // days read at once by a tile: two panels of PANEL x TILE doubles stay in L2
+    constexpr Eigen::Index PANEL { 256 };
+
+    ReturnStatistics computeStatistics(const Eigen::Ref<const Eigen::MatrixXd>& returns, const double annualization,
+        const std::function<void(std::size_t, const std::function<void(std::size_t)>&)>& run_tasks)
+    {
+        const Eigen::Index n_days = returns.rows();
+        const Eigen::Index n_assets = returns.cols();
+        if (n_days < 2)
+        {
+            throw std::invalid_argument("computeReturnStatistics: the covariance needs at least 2 days.");
+        }
+
+        // shift of each column: the first day, close to the mean compared with the size of the returns
+        const Eigen::RowVectorXd shift = returns.row(0);
+
+        // tile pairs (I, J) with J >= I: every task writes its own block of the sums
+        const Eigen::Index tile_count = (n_assets + TILE - 1) / TILE;
+        std::vector<std::pair<Eigen::Index, Eigen::Index>> tiles;
+        for (Eigen::Index i = 0; i < tile_count; ++i)
+        {
+            for (Eigen::Index j = i; j < tile_count; ++j)
+            {
+                tiles.emplace_back(i, j);
+            }
+        }
+
+        Eigen::MatrixXd comoment(n_assets, n_assets);
+        Eigen::RowVectorXd sums(n_assets);
+
+        run_tasks(tiles.size(), [&](const std::size_t task)
+        {
+            const Eigen::Index first_i = tiles[task].first * TILE;
+            const Eigen::Index first_j = tiles[task].second * TILE;
+            const Eigen::Index width_i = std::min(TILE, n_assets - first_i);
+            const Eigen::Index width_j = std::min(TILE, n_assets - first_j);
+            const bool diagonal = first_i == first_j;
+
+            Eigen::MatrixXd block = Eigen::MatrixXd::Zero(width_i, width_j);
+            Eigen::RowVectorXd block_sums = Eigen::RowVectorXd::Zero(width_i);
+            Eigen::MatrixXd panel_i(PANEL, width_i);
+            Eigen::MatrixXd panel_j(PANEL, diagonal ? 0 : width_j);
+
+            for (Eigen::Index day = 0; day < n_days; day += PANEL)
+            {
+                const Eigen::Index rows = std::min(PANEL, n_days - day);
+                auto shifted_i = panel_i.topRows(rows);
+                shifted_i = returns.block(day, first_i, rows, width_i).rowwise() - shift.segment(first_i, width_i);
+
+                if (diagonal)
+                {
+                    // symmetric tile: only the lower half is computed (SYRK)
+                    block.selfadjointView<Eigen::Lower>().rankUpdate(shifted_i.transpose());
+                    block_sums += shifted_i.colwise().sum();
+                } else {
+                    auto shifted_j = panel_j.topRows(rows);
+                    shifted_j = returns.block(day, first_j, rows, width_j).rowwise() - shift.segment(first_j, width_j);
+                    block.noalias() += shifted_i.transpose() * shifted_j;
+                }
+            }
+
+            if (diagonal)
+            {
+                block.triangularView<Eigen::StrictlyUpper>() = block.transpose().eval();
+                sums.segment(first_i, width_i) = block_sums;
+            }
+            comoment.block(first_i, first_j, width_i, width_j) = block;
+            if (!diagonal)
+            {
+                comoment.block(first_j, first_i, width_j, width_i) = block.transpose();
+            }
+        });
+
+        // sum of (x - s)(x - s)^T - n * (m - s)(m - s)^T = sum of (x - m)(x - m)^T
+        // (the factor sqrt(n) is on both sides so that the result stays exactly symmetric)
+        const auto n = static_cast<double>(n_days);
+        const Eigen::RowVectorXd shifted_mean = sums / n;
+        const Eigen::RowVectorXd scaled_mean = shifted_mean * std::sqrt(n);
+        comoment.noalias() -= scaled_mean.transpose() * scaled_mean;
+
+        ReturnStatistics statistics;
+        statistics.mean = (shift + shifted_mean).transpose();
+        statistics.covariance = comoment * (annualization / (n - 1.0));
+        return statistics;
+    }
+}
+
+ReturnStatistics computeReturnStatistics(const Eigen::Ref<const Eigen::MatrixXd>& returns, ThreadPool& pool, const double annualization)
+{
+    return computeStatistics(returns, annualization, [&pool](const std::size_t count, const std::function<void(std::size_t)>& task)
+    {
+        pool.parallelFor(count, task);
+    });
+}
+
+ReturnStatistics computeReturnStatistics(const Eigen::Ref<const Eigen::MatrixXd>& returns, const double annualization)
+{
+    return computeStatistics(returns, annualization, [](const std::size_t count, const std::function<void(std::size_t)>& task)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            task(i);
+        }
+    });
+}
+
+ReturnStatistics computePairwiseStatistics(const Eigen::Ref<const Eigen::MatrixXd>& returns, const double annualization)
+{
+    // 1 where the return is known: the counts and the sums of every pair are matrix products with the mask
+    const Eigen::MatrixXd mask = (returns.array() == returns.array()).cast<double>();
+    const Eigen::RowVectorXd counts = mask.colwise().sum();
+
+    ReturnStatistics statistics;
+    statistics.mean = (mask.array() > 0.0).select(returns, 0.0).colwise().sum().cwiseQuotient(counts).transpose();
+
+    // centered by the mean of each asset (0 where missing): the pair sums only lose precision by the
+    // difference between the means of the common days and the full means
+    const Eigen::MatrixXd centered = (mask.array() > 0.0).select(returns.rowwise() - statistics.mean.transpose(), 0.0);
+    const Eigen::MatrixXd pair_counts = mask.transpose() * mask;
+    if (pair_counts.minCoeff() < 2.0)
+    {
+        throw std::invalid_argument("computePairwiseStatistics: every pair of assets needs at least 2 common days.");
+    }
+    // sums(i, j): sum of the returns of i on the days j is known
+    const Eigen::MatrixXd sums = centered.transpose() * mask;
+
+    // sum of x_i x_j - (sum of x_i)(sum of x_j) / n over the common days of i and j
+    Eigen::MatrixXd comoment = centered.transpose() * centered;
+    comoment.array() -= sums.array() * sums.transpose().array() / pair_counts.array();
+    statistics.covariance = comoment.array() * annualization / (pair_counts.array() - 1.0);
+    statistics.covariance = (0.5 * (statistics.covariance + statistics.covariance.transpose())).eval();
+    return statistics;
+}
+
+RollingCovariance::RollingCovariance(const Eigen::Index asset_count, const std::size_t window, const double annualization)
+    : f_annualization{ annualization }
+    , m_window(static_cast<Eigen::Index>(window), asset_count)
+    , v_mean{ Eigen::VectorXd::Zero(asset_count) }
+    , m_comoment{ Eigen::MatrixXd::Zero(asset_count, asset_count) }
+{
+    if (window < 2)
+    {
+        throw std::invalid_argument("RollingCovariance: the window must hold at least 2 days.");
+    }
+}
+
+// getters
+std::size_t RollingCovariance::getWindow() const
+{
+    return static_cast<std::size_t>(m_window.rows());
+}
+std::size_t RollingCovariance::getCount() const
+{
+    return i_count;
+}
+const Eigen::VectorXd& RollingCovariance::getMean() const
+{
+    return v_mean;
+}
+
+Eigen::MatrixXd RollingCovariance::getCovariance() const
+{
+    if (i_count < 2)
+    {
+        throw std::logic_error("RollingCovariance: the covariance needs at least 2 days.");
+    }
+    return m_comoment * (f_annualization / static_cast<double>(i_count - 1));
+}
+
+// Welford: with d = x - old mean, the co-moment grows by (n - 1) / n * d * d^T
+void RollingCovariance::addToSums(const Eigen::VectorXd& returns)
+{
+    ++i_count;
+    const double n = static_cast<double>(i_count);
+    const Eigen::VectorXd deviation = returns - v_mean;
+    v_mean += deviation / n;
+    m_comoment.noalias() += ((n - 1.0) / n) * deviation * deviation.transpose();
+}
+
+// the inverse of addToSums(): d = x - new mean, the co-moment shrinks by (n - 1) / n * d * d^T (n before the removal)
+void RollingCovariance::removeFromSums(const Eigen::VectorXd& returns)
+{
+    const double n = static_cast<double>(i_count);
+    --i_count;
+    if (i_count == 0)
+    {
+        v_mean.setZero();
+        m_comoment.setZero();
+        return;
+    }
+    v_mean = (n * v_mean - returns) / (n - 1.0);
+    const Eigen::VectorXd deviation = returns - v_mean;
+    m_comoment.noalias() -= ((n - 1.0) / n) * deviation * deviation.transpose();
+}
+
+void RollingCovariance::rebuild()
+{
+    // the slots of the window are all in use when it is rebuilt: their order doesn't matter for the sums
+    v_mean = m_window.colwise().mean().transpose();
+    const RowMajorMatrix centered = m_window.rowwise() - v_mean.transpose();
+    m_comoment.noalias() = centered.transpose() * centered;
+    i_evictions = 0;
+}
+
+void RollingCovariance::add(const Eigen::VectorXd& returns)
+{
+    if (returns.size() != m_window.cols())
+    {
+        throw std::invalid_argument("RollingCovariance: one return per asset is needed.");
+    }
+
+    const auto window = static_cast<std::size_t>(m_window.rows());
+    if (i_count < window)
+    {
+        m_window.row(static_cast<Eigen::Index>((i_oldest + i_count) % window)) = returns.transpose();
+        addToSums(returns);
+        return;
+    }
+
+    // full window: the new day takes the slot of the oldest one
+    removeFromSums(m_window.row(static_cast<Eigen::Index>(i_oldest)).transpose());
+    m_window.row(static_cast<Eigen::Index>(i_oldest)) = returns.transpose();
+    i_oldest = (i_oldest + 1) % window;
+    addToSums(returns);
+
+    // one rebuild every `window` days keeps the cost O(N^2) per day on average
+    if (++i_evictions == window)
+    {
+        rebuild();
+    }
+}
+
+void RollingCovariance::addDays(const Eigen::MatrixXd& returns)
+{
+    for (Eigen::Index day = 0; day < returns.rows(); ++day)
+    {
+        add(Eigen::VectorXd(returns.row(day).transpose()));
+    }
+}
+
+EwmaCovariance::EwmaCovariance(const Eigen::Index asset_count, const double lambda, const double annualization)
+    : f_lambda{ lambda }
+    , f_annualization{ annualization }
+    , v_mean{ Eigen::VectorXd::Zero(asset_count) }
+    , m_weighted_sum{ Eigen::MatrixXd::Zero(asset_count, asset_count) }
+{
+    if (lambda <= 0.0 || lambda >= 1.0)
+    {
+        throw std::invalid_argument("EwmaCovariance: lambda must be in (0, 1).");
+    }
+}
+
+// getters
+double EwmaCovariance::getLambda() const
+{
+    return f_lambda;
+}
+std::uint64_t EwmaCovariance::getCount() const
+{
+    return i_count;
+}
+const Eigen::VectorXd& EwmaCovariance::getMean() const
+{
+    return v_mean;
+}
+
+Eigen::MatrixXd EwmaCovariance::getCovariance() const
+{
+    if (i_count == 0)
+    {
+        throw std::logic_error("EwmaCovariance: the covariance needs at least 1 day.");
+    }
+    return m_weighted_sum * (f_annualization / f_weight_sum);
+}
+
+void EwmaCovariance::add(const Eigen::VectorXd& returns)
+{
+    if (returns.size() != v_mean.size())
+    {
+        throw std::invalid_argument("EwmaCovariance: one return per asset is needed.");
+    }
+
+    // unnormalized sums: older days decay by lambda, the new one enters with weight 1 - lambda
+    const double previous_weight = f_weight_sum;
+    f_weight_sum = f_lambda * f_weight_sum + (1.0 - f_lambda);
+    v_mean = (f_lambda * previous_weight * v_mean + (1.0 - f_lambda) * returns) / f_weight_sum;
+    m_weighted_sum *= f_lambda;
+    m_weighted_sum.noalias() += (1.0 - f_lambda) * returns * returns.transpose();
+    ++i_count;
+}
+
+void EwmaCovariance::addDays(const Eigen::MatrixXd& returns)
+{
+    for (Eigen::Index day = 0; day < returns.rows(); ++day)
+    {
+        add(Eigen::VectorXd(returns.row(day).transpose()));
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <Eigen/Dense>
+#include "ThreadPool.h"
+
+// Mean and annualized sample covariance of a return matrix (days x assets)
+struct ReturnStatistics
+{
+    Eigen::VectorXd mean;
+    Eigen::MatrixXd covariance;
+};
+
+// Mean and covariance in one pass over the returns, without any full-size temporary: the covariance is built by
+// tiles of columns (a blocked SYRK: X_I^T * X_J, only the tiles J >= I) that run in parallel on the pool, and each tile
+// reads the days in panels that stay in cache. The returns are shifted by the first day, so the sums don't lose
+// precision when the mean is large compared with the deviations. Same estimator as getReturnCovarianceMatrix().
+ReturnStatistics computeReturnStatistics(const Eigen::Ref<const Eigen::MatrixXd>& returns, ThreadPool& pool, double annualization = 252.0);
+// same on the calling thread only
+ReturnStatistics computeReturnStatistics(const Eigen::Ref<const Eigen::MatrixXd>& returns, double annualization = 252.0);
+
+// Same estimators on a return matrix with missing values (NaN, see MissingDates::Pairwise): the mean of each asset
+// uses its own days, the covariance of each pair the days both assets have. The matrix may not be positive definite
+// when the histories overlap little. Throws std::invalid_argument if a pair has fewer than 2 common days.
+ReturnStatistics computePairwiseStatistics(const Eigen::Ref<const Eigen::MatrixXd>& returns, double annualization = 252.0);
+
+// Covariance of the last `window` days of returns, updated in O(N^2) when a day is appended (and the oldest one
+// evicted) instead of recentering the whole return matrix. Mean and covariance are always available without a rescan.
+// Same estimator as MultiEquityPortfolio::getReturnCovarianceMatrix() on the rows in the window.
+class RollingCovariance
+{
+private:
+    using RowMajorMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    double f_annualization{};
+    // the days in the window, circular: the oldest one is at i_oldest
+    RowMajorMatrix m_window;
+    std::size_t i_oldest{};
+    std::size_t i_count{};
+    // evictions since the last rebuild: the running sums are recomputed every `window` evictions
+    std::size_t i_evictions{};
+    Eigen::VectorXd v_mean;
+    // sum of the outer products of the deviations from the mean (Welford co-moment)
+    Eigen::MatrixXd m_comoment;
+
+    void addToSums(const Eigen::VectorXd& returns);
+    void removeFromSums(const Eigen::VectorXd& returns);
+    // recompute mean and co-moment from the window: the error of the add/remove updates doesn't accumulate
+    void rebuild();
+public:
+    RollingCovariance(Eigen::Index asset_count, std::size_t window, double annualization = 252.0);
+
+    // getters
+    std::size_t getWindow() const;
+    std::size_t getCount() const;
+    const Eigen::VectorXd& getMean() const;
+    // annualized sample covariance (n - 1 denominator), needs at least 2 days
+    Eigen::MatrixXd getCovariance() const;
+
+    // append one day of returns (one per asset): O(N^2), plus the eviction of the oldest day when the window is full
+    void add(const Eigen::VectorXd& returns);
+    // append the rows of a return matrix (days x assets) in order
+    void addDays(const Eigen::MatrixXd& returns);
+};
+
+// Exponentially weighted covariance (RiskMetrics): Sigma_t = lambda * Sigma_t-1 + (1 - lambda) * r_t * r_t^T,
+// zero-mean returns as in RiskMetrics, O(N^2) per day and no window to keep.
+// The weights are normalized by their sum, so the first days aren't biased towards 0.
+class EwmaCovariance
+{
+private:
+    double f_lambda{};
+    double f_annualization{};
+    double f_weight_sum{};
+    std::uint64_t i_count{};
+    Eigen::VectorXd v_mean;
+    Eigen::MatrixXd m_weighted_sum;
+public:
+    // lambda = 0.94 is the RiskMetrics value for daily returns
+    EwmaCovariance(Eigen::Index asset_count, double lambda = 0.94, double annualization = 252.0);
+
+    // getters
+    double getLambda() const;
+    std::uint64_t getCount() const;
+    // exponentially weighted mean of the returns (for the drift, not used by the covariance)
+    const Eigen::VectorXd& getMean() const;
+    // annualized covariance
+    Eigen::MatrixXd getCovariance() const;
+
+    // append one day of returns (one per asset): O(N^2)
+    void add(const Eigen::VectorXd& returns);
+    // append the rows of a return matrix (days x assets) in order
+    void addDays(const Eigen::MatrixXd& returns);
+};
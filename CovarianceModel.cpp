@@ -0,0 +1,191 @@
+#include "CovarianceModel.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+CholeskyModel::CholeskyModel(Eigen::MatrixXd cholesky_lower)
+    : m_cholesky_lower{std::move(cholesky_lower)}
+{
+    if (m_cholesky_lower.rows() != m_cholesky_lower.cols())
+    {
+        throw std::invalid_argument("CholeskyModel: the Cholesky factor must be square.");
+    }
+}
+
+CholeskyModel CholeskyModel::fromCovariance(const Eigen::MatrixXd& covariance)
+{
+    const Eigen::LLT<Eigen::MatrixXd> llt(covariance);
+    if (llt.info() == Eigen::NumericalIssue)
+    {
+        throw std::invalid_argument("CholeskyModel: covariance matrix is not positive definite.");
+    }
+    return CholeskyModel(llt.matrixL());
+}
+
+// getters
+const Eigen::MatrixXd& CholeskyModel::getCholeskyLower() const
+{
+    return m_cholesky_lower;
+}
+
+void CholeskyModel::appendAsset(const Eigen::VectorXd& covariance_column)
+{
+    const Eigen::Index n = m_cholesky_lower.rows();
+    if (covariance_column.size() != n + 1)
+    {
+        throw std::invalid_argument("CholeskyModel: the covariance column must have one element per asset plus the variance.");
+    }
+
+    // new row [l^T d] with L * l = covariances (forward substitution) and d^2 = variance - l^T * l
+    const Eigen::VectorXd row = m_cholesky_lower.triangularView<Eigen::Lower>().solve(covariance_column.head(n));
+    const double pivot = covariance_column(n) - row.squaredNorm();
+    if (!(pivot > 0.0))
+    {
+        throw std::invalid_argument("CholeskyModel: covariance matrix is not positive definite with the new asset.");
+    }
+
+    m_cholesky_lower.conservativeResize(n + 1, n + 1);
+    m_cholesky_lower.col(n).setZero();
+    m_cholesky_lower.row(n).head(n) = row.transpose();
+    m_cholesky_lower(n, n) = std::sqrt(pivot);
+}
+
+void CholeskyModel::removeAsset(const Eigen::Index index)
+{
+    const Eigen::Index n = m_cholesky_lower.rows();
+    if (index < 0 || index >= n)
+    {
+        throw std::out_of_range("CholeskyModel: asset index out of range.");
+    }
+
+    // without row and column k, the trailing block must satisfy L33' * L33'^T = L33 * L33^T + l32 * l32^T,
+    // where l32 is column k below the diagonal: a rank-1 update with Givens-like rotations, column by column
+    const Eigen::Index tail = n - index - 1;
+    Eigen::VectorXd x = m_cholesky_lower.col(index).tail(tail);
+    auto trailing = m_cholesky_lower.bottomRightCorner(tail, tail);
+    for (Eigen::Index k = 0; k < tail; ++k)
+    {
+        const double diagonal = trailing(k, k);
+        const double radius = std::hypot(diagonal, x(k));
+        const double c = radius / diagonal;
+        const double s = x(k) / diagonal;
+        trailing(k, k) = radius;
+
+        const Eigen::Index below = tail - k - 1;
+        auto column = trailing.col(k).tail(below);
+        auto rest = x.tail(below);
+        column = (column + s * rest) / c;
+        rest = c * rest - s * column;
+    }
+
+    // drop row and column k: shift the trailing rows up and the trailing columns left
+    m_cholesky_lower.block(index, 0, tail, n) = m_cholesky_lower.bottomRows(tail).eval();
+    m_cholesky_lower.block(0, index, n, tail) = m_cholesky_lower.rightCols(tail).eval();
+    m_cholesky_lower.conservativeResize(n - 1, n - 1);
+}
+
+Eigen::Index CholeskyModel::getAssetCount() const
+{
+    return m_cholesky_lower.rows();
+}
+Eigen::Index CholeskyModel::getNormalCount() const
+{
+    return m_cholesky_lower.rows();
+}
+Eigen::VectorXd CholeskyModel::getVariances() const
+{
+    return m_cholesky_lower.rowwise().squaredNorm();
+}
+
+void CholeskyModel::correlate(const Eigen::Ref<const Eigen::MatrixXd>& normals, Eigen::Ref<Eigen::MatrixXd> shocks) const
+{
+    shocks.noalias() = normals * m_cholesky_lower.transpose().triangularView<Eigen::Upper>();
+}
+
+FactorModel::FactorModel(Eigen::MatrixXd loadings, const Eigen::VectorXd& idiosyncratic_variances)
+    : m_loadings{std::move(loadings)}
+{
+    if (m_loadings.rows() != idiosyncratic_variances.size())
+    {
+        throw std::invalid_argument("FactorModel: loadings and idiosyncratic variances have different numbers of assets.");
+    }
+    if ((idiosyncratic_variances.array() < 0.0).any())
+    {
+        throw std::invalid_argument("FactorModel: idiosyncratic variances must be >= 0.");
+    }
+    v_idiosyncratic_vol = idiosyncratic_variances.cwiseSqrt();
+}
+
+FactorModel FactorModel::fromReturns(const Eigen::Ref<const Eigen::MatrixXd>& returns, const Eigen::Index factor_count, const double annualization)
+{
+    const Eigen::Index n_days = returns.rows();
+    const Eigen::Index n_assets = returns.cols();
+    if (n_days < 2 || factor_count < 1 || factor_count > std::min(n_days - 1, n_assets))
+    {
+        throw std::invalid_argument("FactorModel: factor count must be between 1 and min(days - 1, assets).");
+    }
+    if (returns.hasNaN())
+    {
+        throw std::invalid_argument("FactorModel: the returns have missing values, align them with MissingDates::Drop or ForwardFill.");
+    }
+
+    // centered returns scaled so that Sigma = X^T * X (annualized)
+    const Eigen::RowVectorXd mean_row = returns.colwise().mean();
+    const Eigen::MatrixXd X = (returns.rowwise() - mean_row) * std::sqrt(annualization / static_cast<double>(n_days - 1));
+
+    // the eigenvalues are in ascending order: the last factor_count columns are the principal components
+    Eigen::MatrixXd loadings(n_assets, factor_count);
+    if (n_days < n_assets)
+    {
+        // X * X^T (days x days) has the same non-zero eigenvalues as Sigma, and X^T * u / sqrt(lambda) is the unit
+        // eigenvector of Sigma: the loading B = v * sqrt(lambda) is simply X^T * u
+        const Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(X * X.transpose());
+        loadings.noalias() = X.transpose() * solver.eigenvectors().rightCols(factor_count).rowwise().reverse();
+    } else {
+        const Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(X.transpose() * X);
+        const Eigen::VectorXd eigenvalues = solver.eigenvalues().tail(factor_count).reverse().cwiseMax(0.0);
+        loadings.noalias() = solver.eigenvectors().rightCols(factor_count).rowwise().reverse() * eigenvalues.cwiseSqrt().asDiagonal();
+    }
+
+    // the residual of each sample variance, >= 0 up to rounding
+    const Eigen::VectorXd variances = X.colwise().squaredNorm().transpose();
+    const Eigen::VectorXd idiosyncratic_variances = (variances - loadings.rowwise().squaredNorm()).cwiseMax(0.0);
+
+    return FactorModel(std::move(loadings), idiosyncratic_variances);
+}
+
+// getters
+const Eigen::MatrixXd& FactorModel::getLoadings() const
+{
+    return m_loadings;
+}
+const Eigen::VectorXd& FactorModel::getIdiosyncraticVol() const
+{
+    return v_idiosyncratic_vol;
+}
+Eigen::Index FactorModel::getFactorCount() const
+{
+    return m_loadings.cols();
+}
+
+Eigen::Index FactorModel::getAssetCount() const
+{
+    return m_loadings.rows();
+}
+Eigen::Index FactorModel::getNormalCount() const
+{
+    return m_loadings.cols() + m_loadings.rows();
+}
+Eigen::VectorXd FactorModel::getVariances() const
+{
+    return m_loadings.rowwise().squaredNorm() + v_idiosyncratic_vol.cwiseAbs2();
+}
+
+void FactorModel::correlate(const Eigen::Ref<const Eigen::MatrixXd>& normals, Eigen::Ref<Eigen::MatrixXd> shocks) const
+{
+    // each row is B * f + D * e: f are the first K normals, e the last N
+    const Eigen::Index factor_count = getFactorCount();
+    shocks.noalias() = normals.rightCols(getAssetCount()) * v_idiosyncratic_vol.asDiagonal();
+    shocks.noalias() += normals.leftCols(factor_count) * m_loadings.transpose();
+}
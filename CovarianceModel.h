@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <Eigen/Dense>
+
+// How the engine turns independent N(0, 1) numbers into correlated shocks: every row of the shocks has covariance Sigma
+class CovarianceModel
+{
+public:
+    virtual ~CovarianceModel() = default;
+
+    // number of assets N (columns of the shocks)
+    virtual Eigen::Index getAssetCount() const = 0;
+    // independent normals needed by one simulation step (columns of the normals)
+    virtual Eigen::Index getNormalCount() const = 0;
+    // diagonal of Sigma, used by the Ito correction of the drift
+    virtual Eigen::VectorXd getVariances() const = 0;
+
+    // shocks (rows x N) from normals (rows x getNormalCount())
+    virtual void correlate(const Eigen::Ref<const Eigen::MatrixXd>& normals, Eigen::Ref<Eigen::MatrixXd> shocks) const = 0;
+};
+
+// Dense covariance: Sigma = L * L^T with the Cholesky factor, O(N^2) per simulation step
+class CholeskyModel : public CovarianceModel
+{
+private:
+    Eigen::MatrixXd m_cholesky_lower;
+public:
+    explicit CholeskyModel(Eigen::MatrixXd cholesky_lower);
+
+    // Cholesky factor of a covariance matrix: throws std::invalid_argument if it isn't positive definite
+    static CholeskyModel fromCovariance(const Eigen::MatrixXd& covariance);
+
+    // getters
+    const Eigen::MatrixXd& getCholeskyLower() const;
+
+    // Incremental updates in O(N^2) instead of a new O(N^3) decomposition, same factor as a full rebuild up to rounding
+    // add an asset: covariance_column holds its covariances with the current assets followed by its variance (N + 1)
+    // throws std::invalid_argument if the new covariance isn't positive definite
+    void appendAsset(const Eigen::VectorXd& covariance_column);
+    // remove the asset at index: the factor of the remaining assets comes from a rank-1 update of the trailing block
+    void removeAsset(Eigen::Index index);
+
+    Eigen::Index getAssetCount() const override;
+    Eigen::Index getNormalCount() const override;
+    Eigen::VectorXd getVariances() const override;
+    // each row is L * z, i.e. z^T * L^T: a triangular multiply that skips the zeros of L
+    void correlate(const Eigen::Ref<const Eigen::MatrixXd>& normals, Eigen::Ref<Eigen::MatrixXd> shocks) const override;
+};
+
+// Factor model: Sigma = B * B^T + D^2 with K << N factors, the shocks are B * f + D * e, O(N * K) per simulation step
+// and no Cholesky decomposition. Sigma is positive semi-definite by construction.
+class FactorModel : public CovarianceModel
+{
+private:
+    // factor loadings B (N x K)
+    Eigen::MatrixXd m_loadings;
+    // idiosyncratic volatilities: the diagonal of D (N)
+    Eigen::VectorXd v_idiosyncratic_vol;
+public:
+    // user-supplied loadings (N x K) and idiosyncratic variances (N, >= 0)
+    FactorModel(Eigen::MatrixXd loadings, const Eigen::VectorXd& idiosyncratic_variances);
+
+    // PCA of the sample covariance of a return matrix (days x assets) with the first factor_count components,
+    // annualized like MultiEquityPortfolio::getReturnCovarianceMatrix(). The dense N x N matrix is never built:
+    // with fewer days than assets the eigenvectors come from the days x days Gram matrix. The idiosyncratic
+    // variances are what the factors don't explain of the sample variances, so the diagonal of Sigma is exact.
+    static FactorModel fromReturns(const Eigen::Ref<const Eigen::MatrixXd>& returns, Eigen::Index factor_count, double annualization = 252.0);
+
+    // getters
+    const Eigen::MatrixXd& getLoadings() const;
+    const Eigen::VectorXd& getIdiosyncraticVol() const;
+    Eigen::Index getFactorCount() const;
+
+    Eigen::Index getAssetCount() const override;
+    // K factor normals followed by N idiosyncratic normals
+    Eigen::Index getNormalCount() const override;
+    Eigen::VectorXd getVariances() const override;
+    void correlate(const Eigen::Ref<const Eigen::MatrixXd>& normals, Eigen::Ref<Eigen::MatrixXd> shocks) const override;
+};
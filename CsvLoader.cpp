@@ -0,0 +1,405 @@
+#include "CsvLoader.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <string_view>
+
+namespace
+{
+    std::string_view fileText(const MappedFile& file)
+    {
+        return { reinterpret_cast<const char*>(file.data()), file.size() };
+    }
+
+    // next line of the text from position, without the line ending (\n or \r\n); position moves past it
+    std::string_view nextLine(const std::string_view text, std::size_t& position)
+    {
+        const std::size_t start = position;
+        const void* newline = std::memchr(text.data() + start, '\n', text.size() - start);
+        const std::size_t end = newline != nullptr ? static_cast<std::size_t>(static_cast<const char*>(newline) - text.data()) : text.size();
+        position = end + 1;
+
+        std::string_view line = text.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+        return line;
+    }
+
+    // index of a column in the header, or -1
+    int columnIndex(const std::string_view header, const std::string_view name)
+    {
+        int index = 0;
+        std::size_t start = 0;
+        while (true)
+        {
+            const std::size_t comma = header.find(',', start);
+            if (header.substr(start, comma - start) == name)
+            {
+                return index;
+            }
+            if (comma == std::string_view::npos)
+            {
+                return -1;
+            }
+            start = comma + 1;
+            ++index;
+        }
+    }
+
+    [[noreturn]] void throwParseError(const MappedFile& file, const std::size_t line_number, const std::string& what)
+    {
+        throw std::runtime_error(file.getPath() + ":" + std::to_string(line_number) + ": " + what);
+    }
+}
+
+std::int32_t parseDate(const std::string_view text)
+{
+    if (text.size() < 10 || text[4] != '-' || text[7] != '-')
+    {
+        return -1;
+    }
+
+    std::int32_t date = 0;
+    for (const std::size_t i : { 0, 1, 2, 3, 5, 6, 8, 9 })
+    {
+        if (text[i] < '0' || text[i] > '9')
+        {
+            return -1;
+        }
+        date = date * 10 + (text[i] - '0');
+    }
+    return date;
+}
+
+std::size_t countCsvRows(const MappedFile& file)
+{
+    const std::string_view text = fileText(file);
+    std::size_t position = 0;
+    nextLine(text, position);
+
+    std::size_t rows = 0;
+    while (position < text.size())
+    {
+        if (!nextLine(text, position).empty())
+        {
+            ++rows;
+        }
+    }
+    return rows;
+}
+
+CsvTail findCsvTail(const MappedFile& file, const std::size_t window)
+{
+    const std::string_view text = fileText(file);
+    std::size_t header_end = 0;
+    nextLine(text, header_end);
+    header_end = std::min(header_end, text.size());
+
+    CsvTail tail{ text.size(), 0 };
+    // end of the current line, without its newline
+    std::size_t line_end = text.size();
+    if (line_end > header_end && text[line_end - 1] == '\n')
+    {
+        --line_end;
+    }
+    while (tail.rows < window && line_end >= header_end)
+    {
+        // last newline before the end of the line (rfind is portable, memrchr is a GNU extension)
+        const std::size_t newline = line_end > header_end ? text.rfind('\n', line_end - 1) : std::string_view::npos;
+        const std::size_t line_start = newline != std::string_view::npos && newline >= header_end ? newline + 1 : header_end;
+
+        std::string_view line = text.substr(line_start, line_end - line_start);
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+        if (!line.empty())
+        {
+            tail.offset = line_start;
+            ++tail.rows;
+        }
+        if (line_start == header_end)
+        {
+            break;
+        }
+        line_end = line_start - 1;
+    }
+    return tail;
+}
+
+double parseReturnCsv(const MappedFile& file, const std::span<double> log_returns, const std::span<double> close_prices,
+    const std::span<std::int32_t> dates, const std::size_t first_row_offset)
+{
+    const std::string_view text = fileText(file);
+    std::size_t position = 0;
+    const std::string_view header = nextLine(text, position);
+
+    const int close_column = columnIndex(header, "Close");
+    const int return_column = columnIndex(header, "Log Returns");
+    if (close_column < 0 || return_column < 0)
+    {
+        throwParseError(file, 1, "the header has no \"Close\" or \"Log Returns\" column");
+    }
+    // the dates are parsed only when they are requested
+    const int date_column = dates.empty() ? -1 : columnIndex(header, "Date");
+    if (!dates.empty() && date_column < 0)
+    {
+        throwParseError(file, 1, "the header has no \"Date\" column");
+    }
+    const int last_column = std::max({ close_column, return_column, date_column });
+
+    // the lines before the first parsed one are only counted for an error message
+    const std::size_t start = std::max(position, first_row_offset);
+    const auto throwLineError = [&](const std::size_t line_number, const std::string& what)
+    {
+        const auto lines_before = static_cast<std::size_t>(std::count(text.begin(), text.begin() + static_cast<std::ptrdiff_t>(std::min(start, text.size())), '\n'));
+        throwParseError(file, lines_before + line_number, what);
+    };
+
+    position = start;
+    std::size_t row = 0;
+    std::size_t line_number = 0;
+    double close_price = 0.0;
+    while (position < text.size())
+    {
+        const std::string_view line = nextLine(text, position);
+        ++line_number;
+        if (line.empty())
+        {
+            continue;
+        }
+        if (row == log_returns.size())
+        {
+            throwLineError(line_number, "more rows than expected");
+        }
+
+        // walk the fields up to the last one needed, parsing only the two numbers
+        const char* field = line.data();
+        const char* const line_end = line.data() + line.size();
+        for (int column = 0; column <= last_column; ++column)
+        {
+            const char* field_end = static_cast<const char*>(std::memchr(field, ',', static_cast<std::size_t>(line_end - field)));
+            if (field_end == nullptr)
+            {
+                field_end = line_end;
+            }
+            if (column == date_column)
+            {
+                dates[row] = parseDate(std::string_view(field, static_cast<std::size_t>(field_end - field)));
+                if (dates[row] < 0)
+                {
+                    throwLineError(line_number, "invalid date in column " + std::to_string(column + 1));
+                }
+            } else if (column == close_column || column == return_column) {
+                double value;
+                const auto [end, error] = std::from_chars(field, field_end, value);
+                if (error != std::errc{} || end != field_end)
+                {
+                    throwLineError(line_number, "invalid number in column " + std::to_string(column + 1));
+                }
+                (column == close_column ? close_price : log_returns[row]) = value;
+            }
+            if (field_end == line_end && column < last_column)
+            {
+                throwLineError(line_number, "missing columns");
+            }
+            field = field_end + 1;
+        }
+
+        if (!close_prices.empty())
+        {
+            close_prices[row] = close_price;
+        }
+        ++row;
+    }
+
+    if (row != log_returns.size())
+    {
+        throwLineError(line_number, "fewer rows than expected");
+    }
+    return close_price;
+}
+
+ReturnData loadReturnData(const std::vector<std::string>& paths, ThreadPool& pool, const MissingDates missing_dates, const std::size_t lookback)
+{
+    const std::size_t n_tickers = paths.size();
+
+    // every file is mapped and its rows counted in parallel (only the last rows with a lookback)
+    std::vector<MappedFile> files(n_tickers);
+    std::vector<CsvTail> tails(n_tickers);
+    pool.parallelFor(n_tickers, [&](const std::size_t i)
+    {
+        files[i] = MappedFile(paths[i]);
+        tails[i] = lookback > 0 ? findCsvTail(files[i], lookback) : CsvTail{ 0, countCsvRows(files[i]) };
+        if (tails[i].rows == 0)
+        {
+            throw std::runtime_error(paths[i] + ": no data rows");
+        }
+    });
+    ReturnData data;
+    data.last_prices.resize(static_cast<Eigen::Index>(n_tickers));
+    if (n_tickers == 0)
+    {
+        return data;
+    }
+
+    // the log returns are parsed straight into the columns of one matrix (the top rows of column i for file i),
+    // the dates of all the files into one buffer: no per-ticker intermediate
+    std::vector<std::size_t> date_offsets(n_tickers + 1, 0);
+    std::size_t max_rows = 0;
+    for (std::size_t i = 0; i < n_tickers; ++i)
+    {
+        date_offsets[i + 1] = date_offsets[i] + tails[i].rows;
+        max_rows = std::max(max_rows, tails[i].rows);
+    }
+    std::vector<std::int32_t> all_dates(date_offsets.back());
+    Eigen::MatrixXd parsed(static_cast<Eigen::Index>(max_rows), static_cast<Eigen::Index>(n_tickers));
+    const auto tickerDates = [&](const std::size_t i)
+    {
+        return std::span<std::int32_t>(all_dates.data() + date_offsets[i], tails[i].rows);
+    };
+
+    pool.parallelFor(n_tickers, [&](const std::size_t i)
+    {
+        const std::span<std::int32_t> dates = tickerDates(i);
+        data.last_prices(static_cast<Eigen::Index>(i)) = parseReturnCsv(files[i],
+            std::span<double>(parsed.col(static_cast<Eigen::Index>(i)).data(), tails[i].rows), {}, dates, tails[i].offset);
+
+        const auto unsorted = std::adjacent_find(dates.begin(), dates.end(), std::greater_equal<>());
+        if (unsorted != dates.end())
+        {
+            throw std::runtime_error(paths[i] + ": the dates are not increasing after " + std::to_string(*unsorted));
+        }
+    });
+    files.clear();
+
+    // first date where every ticker has a price: forward fill starts there
+    std::int32_t common_start = 0;
+    for (std::size_t i = 0; i < n_tickers; ++i)
+    {
+        common_start = std::max(common_start, tickerDates(i).front());
+    }
+
+    // k-way merge of the date streams with a min-heap of (next date, ticker): every record gets the row of the
+    // aligned matrix it goes to, or -1 when its date is dropped (in the same buffer layout as the dates)
+    std::vector<std::int32_t> target_rows(all_dates.size());
+    std::vector<std::size_t> cursors(n_tickers, 0);
+    using Entry = std::pair<std::int32_t, std::size_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> heap;
+    for (std::size_t i = 0; i < n_tickers; ++i)
+    {
+        heap.emplace(tickerDates(i).front(), i);
+    }
+
+    // a record never moves down when the tickers share their dates or with Drop: the columns are then aligned in place
+    bool aligned_in_place = true;
+    std::vector<std::size_t> present;
+    present.reserve(n_tickers);
+    while (!heap.empty())
+    {
+        const std::int32_t date = heap.top().first;
+        present.clear();
+        while (!heap.empty() && heap.top().first == date)
+        {
+            const std::size_t i = heap.top().second;
+            heap.pop();
+            present.push_back(i);
+            if (cursors[i] + 1 < tails[i].rows)
+            {
+                heap.emplace(tickerDates(i)[cursors[i] + 1], i);
+            }
+        }
+
+        bool keep = true;
+        if (missing_dates == MissingDates::Drop)
+        {
+            keep = present.size() == n_tickers;
+        } else if (missing_dates == MissingDates::ForwardFill) {
+            keep = date >= common_start;
+        }
+        const std::int32_t row = keep ? static_cast<std::int32_t>(data.dates.size()) : -1;
+        if (keep)
+        {
+            data.dates.push_back(date);
+        }
+        for (const std::size_t i : present)
+        {
+            aligned_in_place = aligned_in_place && row <= static_cast<std::int32_t>(cursors[i]);
+            target_rows[date_offsets[i] + cursors[i]++] = row;
+        }
+    }
+    if (data.dates.empty())
+    {
+        throw std::runtime_error("CSV files have no common date: " + std::to_string(n_tickers) + " files");
+    }
+
+    // every column is filled from its own stream, in parallel: the writes are contiguous in the column-major matrix
+    // in place, every record goes to a row at or above its own, which has already been read
+    const auto n_days = static_cast<Eigen::Index>(data.dates.size());
+    const double missing_value = missing_dates == MissingDates::Pairwise ? std::numeric_limits<double>::quiet_NaN() : 0.0;
+    if (!aligned_in_place)
+    {
+        data.log_returns.resize(n_days, static_cast<Eigen::Index>(n_tickers));
+    }
+    Eigen::MatrixXd& aligned = aligned_in_place ? parsed : data.log_returns;
+    pool.parallelFor(n_tickers, [&](const std::size_t i)
+    {
+        const double* returns = parsed.col(static_cast<Eigen::Index>(i)).data();
+        const std::span<const std::int32_t> dates = tickerDates(i);
+        const std::int32_t* rows = target_rows.data() + date_offsets[i];
+        auto column = aligned.col(static_cast<Eigen::Index>(i));
+
+        // log returns of the dropped dates since the last kept one: they are added to the next kept date
+        double pending = 0.0;
+        Eigen::Index next_row = 0;
+        for (std::size_t k = 0; k < dates.size(); ++k)
+        {
+            const std::int32_t row = rows[k];
+            if (row >= 0)
+            {
+                const double value = pending + returns[k];
+                // the dates this ticker misses
+                for (; next_row < row; ++next_row)
+                {
+                    column(next_row) = missing_value;
+                }
+                column(row) = value;
+                next_row = row + 1;
+                pending = 0.0;
+            } else if (dates[k] > data.dates.front()) {
+                pending += returns[k];
+            }
+        }
+        for (; next_row < n_days; ++next_row)
+        {
+            column(next_row) = missing_value;
+        }
+        // dates dropped after the last kept one (Drop): the simulation starts from the close of the last kept date,
+        // the last close of the file without the log returns that came after it
+        if (pending != 0.0)
+        {
+            data.last_prices(static_cast<Eigen::Index>(i)) *= std::exp(-pending);
+        }
+    });
+
+    if (aligned_in_place)
+    {
+        // same dates in every file (the usual case): the parsed matrix is the result, otherwise only its top rows
+        if (n_days == parsed.rows())
+        {
+            data.log_returns = std::move(parsed);
+        } else {
+            data.log_returns = parsed.topRows(n_days);
+        }
+    }
+
+    return data;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+// Log returns of several tickers (days x tickers, one column per file), the close price of each ticker on the last
+// row and the dates of the rows (yyyymmdd)
+struct ReturnData
+{
+    Eigen::MatrixXd log_returns;
+    Eigen::VectorXd last_prices;
+    std::vector<std::int32_t> dates;
+};
+
+// Date "YYYY-MM-DD" (anything after the day is ignored, e.g. a time) as the integer yyyymmdd, -1 if it isn't a date
+std::int32_t parseDate(std::string_view text);
+
+// Number of data rows of a csv file: the lines after the header (the last line may have no newline, empty lines
+// are not counted). Counted with memchr on the mapped file, nothing is parsed.
+std::size_t countCsvRows(const MappedFile& file);
+
+// The last data rows of a csv file: byte offset of the first one and number of rows
+struct CsvTail
+{
+    std::size_t offset;
+    std::size_t rows;
+};
+
+// Find the last `window` data rows of a csv file (all of them when the file has fewer) by scanning backward from
+// the end of the mapped file: only the pages of the window are read, whatever the length of the history.
+// Empty lines are skipped like in countCsvRows().
+CsvTail findCsvTail(const MappedFile& file, std::size_t window);
+
+// Parse the "Close" and "Log Returns" columns of a csv file with a header (Date,Close,Returns,Log Returns) with
+// std::from_chars, straight into the destinations: log_returns must have countCsvRows() elements, close_prices
+// and dates the same or none (only the last close is needed, the "Date" column is skipped). Returns the last close price.
+// With a first_row_offset from findCsvTail() only the rows from there on are parsed (log_returns has CsvTail::rows elements).
+// Errors (missing column, invalid number, wrong row count) throw std::runtime_error with the file and the line.
+double parseReturnCsv(const MappedFile& file, std::span<double> log_returns, std::span<double> close_prices = {},
+    std::span<std::int32_t> dates = {}, std::size_t first_row_offset = 0);
+
+// How loadReturnData() aligns tickers whose histories don't have the same dates
+enum class MissingDates
+{
+    // keep only the dates every ticker has: the log returns of the dropped dates are added to the next kept date,
+    // so the return over the period doesn't change. The dates after the last common one are dropped with their
+    // returns, the last price is the close of the last common date
+    Drop,
+    // keep every date from the first one where all the tickers have started: a missing date keeps the last price
+    // (log return 0)
+    ForwardFill,
+    // keep every date, a missing log return is NaN: the covariance is estimated pair by pair on the dates both
+    // tickers have (see computePairwiseStatistics())
+    Pairwise
+};
+
+// Load the csv files of the tickers in parallel (every file is mapped and parsed once into its own sorted date
+// stream), then merge-join the streams by date in one pass into the aligned matrix, one column per file, with the
+// given handling of the missing dates. The dates of every file must be increasing, otherwise std::runtime_error is thrown.
+// A lookback > 0 reads only the last `lookback` rows of every file (see findCsvTail()), 0 the whole history.
+ReturnData loadReturnData(const std::vector<std::string>& paths, ThreadPool& pool, MissingDates missing_dates = MissingDates::Drop,
+    std::size_t lookback = 0);
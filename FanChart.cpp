@@ -0,0 +1,158 @@
+#include "FanChart.h"
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+    // percentiles of one row in ascending order of percent: each selection works on the part above the previous one
+    void rowPercentiles(const std::span<std::float_t> row, const std::vector<std::size_t>& order, const std::vector<std::float_t>& percents,
+        FanChart& fan_chart, const std::size_t step)
+    {
+        if (row.empty())
+        {
+            for (const std::size_t k : order)
+            {
+                fan_chart.bands[k][step] = 0.0f; // Handle empty row
+            }
+            return;
+        }
+
+        auto begin = row.begin();
+        for (const std::size_t k : order)
+        {
+            // in double as in percentile(): a float index rounds past the end of rows longer than 2^24
+            const double index = (static_cast<double>(percents[k]) / 100.0) * static_cast<double>(row.size() - 1);
+            const auto lower_idx = std::min(static_cast<std::size_t>(index), row.size() - 1);
+            const auto fraction = static_cast<std::float_t>(index - static_cast<double>(lower_idx));
+
+            const auto lower = row.begin() + static_cast<std::ptrdiff_t>(lower_idx);
+            std::nth_element(begin, lower, row.end());
+            begin = lower;
+
+            // Linear interpolation with the next value in sorted order
+            if (lower_idx + 1 < row.size() && fraction > 0.0f)
+            {
+                const std::float_t upper = *std::min_element(lower + 1, row.end());
+                fan_chart.bands[k][step] = *lower + fraction * (upper - *lower);
+            } else {
+                fan_chart.bands[k][step] = *lower;
+            }
+        }
+    }
+
+    std::vector<std::size_t> ascendingOrder(const std::vector<std::float_t>& percents)
+    {
+        for (const std::float_t percent : percents)
+        {
+            if (percent < 0.0f || percent > 100.0f)
+            {
+                throw std::invalid_argument("Percent must be in [0, 100].");
+            }
+        }
+
+        std::vector<std::size_t> order(percents.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](const std::size_t a, const std::size_t b) { return percents[a] < percents[b]; });
+        return order;
+    }
+}
+
+FanChart computeFanChart(PathMatrix& paths, const std::vector<std::float_t>& percents, ThreadPool& pool)
+{
+    const std::vector<std::size_t> order = ascendingOrder(percents);
+
+    FanChart fan_chart{ percents, std::vector(percents.size(), std::vector<std::float_t>(paths.getRows(), 0.0f)) };
+    pool.parallelFor(paths.getRows(), [&](const std::size_t step)
+    {
+        rowPercentiles(paths.row(step), order, percents, fan_chart, step);
+    });
+
+    return fan_chart;
+}
+
+void writeFanChart(const FanChart& fan_chart, const std::string& path)
+{
+    std::ofstream file(path);
+    file << "day";
+    for (const std::float_t percent : fan_chart.percents)
+    {
+        file << ',' << percent;
+    }
+    file << '\n';
+
+    const std::size_t days = fan_chart.bands.empty() ? 0 : fan_chart.bands.front().size();
+    for (std::size_t day = 0; day < days; ++day)
+    {
+        file << day;
+        for (const auto& band : fan_chart.bands)
+        {
+            file << ',' << band[day];
+        }
+        file << '\n';
+    }
+
+    file.close();
+    if (!file)
+    {
+        throw std::runtime_error("FanChart: can't write " + path);
+    }
+}
+
+StreamingFanChart::StreamingFanChart(const std::size_t steps, const double relative_accuracy)
+    : v_sketches(steps, QuantileSketch(relative_accuracy))
+{
+}
+
+// getters
+std::size_t StreamingFanChart::getStepCount() const
+{
+    return v_sketches.size();
+}
+
+void StreamingFanChart::add(const std::size_t step, const std::span<const std::float_t> values)
+{
+    QuantileSketch& sketch = v_sketches.at(step);
+    for (const std::float_t value : values)
+    {
+        sketch.add(static_cast<double>(value));
+    }
+}
+
+void StreamingFanChart::merge(const StreamingFanChart& other)
+{
+    if (other.v_sketches.size() != v_sketches.size())
+    {
+        throw std::invalid_argument("Only fan charts with the same number of steps can be merged.");
+    }
+
+    for (std::size_t t = 0; t < v_sketches.size(); ++t)
+    {
+        v_sketches[t].merge(other.v_sketches[t]);
+    }
+}
+
+FanChart StreamingFanChart::getFanChart(const std::vector<std::float_t>& percents) const
+{
+    ascendingOrder(percents);
+
+    FanChart fan_chart{ percents, std::vector(percents.size(), std::vector<std::float_t>(v_sketches.size(), 0.0f)) };
+    for (std::size_t t = 0; t < v_sketches.size(); ++t)
+    {
+        const std::uint64_t count = v_sketches[t].getCount();
+        if (count == 0)
+        {
+            continue;
+        }
+
+        for (std::size_t k = 0; k < percents.size(); ++k)
+        {
+            // same index as percentile(), rounded down
+            const auto rank = static_cast<std::uint64_t>((percents[k] / 100.0) * static_cast<double>(count - 1));
+            fan_chart.bands[k][t] = static_cast<std::float_t>(v_sketches[t].getValueAtRank(rank));
+        }
+    }
+
+    return fan_chart;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+#include "PathMatrix.h"
+#include "QuantileSketch.h"
+#include "ThreadPool.h"
+
+// Quantile bands of the simulated paths at every time step, usually used to plot
+struct FanChart
+{
+    // percents of the bands, e.g. {1, 5, 50, 95, 99}
+    std::vector<std::float_t> percents;
+    // bands[k][t] is the percents[k] percentile of the paths at step t
+    std::vector<std::vector<std::float_t>> bands;
+};
+
+// Fan chart of a path matrix (steps x simulations): the steps run in parallel on the pool
+// every row is partially reordered in place with std::nth_element, nothing is copied or sorted
+// the percentiles are interpolated as in percentile()
+FanChart computeFanChart(PathMatrix& paths, const std::vector<std::float_t>& percents, ThreadPool& pool);
+
+// csv file of the fan chart to plot it: a "day" column and one column per band, headed by its percent
+// throws std::runtime_error if the file can't be written
+void writeFanChart(const FanChart& fan_chart, const std::string& path);
+
+// Streaming fan chart: one quantile sketch per step is updated while the paths are generated, so the path matrix
+// never has to exist. The bands have the relative error of QuantileSketch and are not interpolated.
+class StreamingFanChart
+{
+private:
+    std::vector<QuantileSketch> v_sketches;
+public:
+    StreamingFanChart(std::size_t steps, double relative_accuracy = 0.001);
+
+    // getters
+    std::size_t getStepCount() const;
+
+    // add the values of some paths at a step
+    void add(std::size_t step, std::span<const std::float_t> values);
+    void merge(const StreamingFanChart& other);
+
+    FanChart getFanChart(const std::vector<std::float_t>& percents) const;
+};
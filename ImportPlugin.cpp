@@ -0,0 +1,113 @@
+#include "ImportPlugin.h"
+#include <array>
+#include <stdexcept>
+#include <utility>
+#include <dlfcn.h>
+
+TickerBatch::TickerBatch(std::vector<std::string> tickers, std::vector<TickerSeries> series, void* batch, const ReleaseBatchFunction release)
+    : v_tickers{ std::move(tickers) }
+    , v_series{ std::move(series) }
+    , p_batch{ batch }
+    , p_release{ release }
+{
+}
+
+TickerBatch::~TickerBatch()
+{
+    release();
+}
+
+TickerBatch::TickerBatch(TickerBatch&& other) noexcept
+    : v_tickers{ std::move(other.v_tickers) }
+    , v_series{ std::move(other.v_series) }
+    , p_batch{ std::exchange(other.p_batch, nullptr) }
+    , p_release{ other.p_release }
+{
+}
+
+TickerBatch& TickerBatch::operator=(TickerBatch&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        v_tickers = std::move(other.v_tickers);
+        v_series = std::move(other.v_series);
+        p_batch = std::exchange(other.p_batch, nullptr);
+        p_release = other.p_release;
+    }
+    return *this;
+}
+
+void TickerBatch::release() noexcept
+{
+    if (p_batch != nullptr)
+    {
+        p_release(p_batch);
+        p_batch = nullptr;
+    }
+}
+
+// getters
+const std::vector<std::string>& TickerBatch::getTickers() const
+{
+    return v_tickers;
+}
+std::size_t TickerBatch::size() const
+{
+    return v_series.size();
+}
+Eigen::Map<const Eigen::VectorXd> TickerBatch::getLogReturns(const std::size_t index) const
+{
+    return { v_series.at(index).log_returns, static_cast<Eigen::Index>(v_series.at(index).rows) };
+}
+Eigen::Map<const Eigen::VectorXd> TickerBatch::getClosePrices(const std::size_t index) const
+{
+    return { v_series.at(index).close_prices, static_cast<Eigen::Index>(v_series.at(index).rows) };
+}
+
+ImportPlugin::ImportPlugin(const std::string& path)
+    : s_path{ path }
+{
+    // never unloaded: an embedded interpreter (and the extension modules it imported) can't be unloaded safely,
+    // and a second dlopen of the same library returns the same, already initialized, plugin
+    // global: the extension modules imported by the interpreter (numpy) resolve the libpython symbols of the plugin
+    void* handle = ::dlopen(path.c_str(), RTLD_NOW | RTLD_GLOBAL | RTLD_NODELETE);
+    if (handle == nullptr)
+    {
+        throw std::runtime_error("ImportPlugin: can't load " + path + ": " + ::dlerror());
+    }
+
+    p_fetch_tickers = reinterpret_cast<FetchTickersFunction>(::dlsym(handle, FETCH_TICKERS_SYMBOL));
+    p_release_batch = reinterpret_cast<ReleaseBatchFunction>(::dlsym(handle, RELEASE_BATCH_SYMBOL));
+    // the reference taken by dlopen is dropped, RTLD_NODELETE keeps the library loaded
+    ::dlclose(handle);
+    if (p_fetch_tickers == nullptr || p_release_batch == nullptr)
+    {
+        throw std::runtime_error("ImportPlugin: " + path + " has no " + FETCH_TICKERS_SYMBOL + " or " + RELEASE_BATCH_SYMBOL);
+    }
+}
+
+// getters
+const std::string& ImportPlugin::getPath() const
+{
+    return s_path;
+}
+
+TickerBatch ImportPlugin::fetchTickers(const std::vector<std::string>& tickers) const
+{
+    std::vector<const char*> names;
+    names.reserve(tickers.size());
+    for (const auto& ticker : tickers)
+    {
+        names.push_back(ticker.c_str());
+    }
+
+    std::vector<TickerSeries> series(tickers.size());
+    void* batch = nullptr;
+    std::array<char, 512> error{};
+    if (p_fetch_tickers(names.data(), names.size(), series.data(), &batch, error.data(), error.size()) != 0)
+    {
+        throw std::runtime_error("ImportPlugin: fetching " + std::to_string(tickers.size()) + " tickers from " + s_path + ": " + error.data());
+    }
+    return TickerBatch(tickers, std::move(series), batch, p_release_batch);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+
+// C interface of an import plugin: a shared library that fetches market data (e.g. yfinance through an embedded
+// Python interpreter). The executable never links Python: the plugin is loaded with dlopen only when it is used.
+extern "C"
+{
+    // daily log returns and close prices of one ticker (the close of the same days): views of arrays owned by the
+    // plugin, valid until the batch is released
+    struct TickerSeries
+    {
+        const double* log_returns;
+        const double* close_prices;
+        std::size_t rows;
+    };
+
+    // fetch count tickers in one call: series[i] is the data of tickers[i] and batch the handle that keeps the arrays
+    // alive. 0 on success, otherwise the message is written to error (NUL-terminated, at most error_size bytes)
+    using FetchTickersFunction = int (*)(const char* const* tickers, std::size_t count, TickerSeries* series, void** batch,
+        char* error, std::size_t error_size);
+    // free the arrays of a batch
+    using ReleaseBatchFunction = void (*)(void* batch);
+}
+
+// symbols exported by a plugin
+inline constexpr const char* FETCH_TICKERS_SYMBOL { "mcvar_fetch_tickers" };
+inline constexpr const char* RELEASE_BATCH_SYMBOL { "mcvar_release_batch" };
+
+// Series of several tickers fetched in one call: the Eigen maps read the arrays of the plugin, nothing is copied.
+// Move-only, the arrays are released with the batch (which must not outlive its plugin).
+class TickerBatch
+{
+private:
+    std::vector<std::string> v_tickers;
+    std::vector<TickerSeries> v_series;
+    void* p_batch{ nullptr };
+    ReleaseBatchFunction p_release{ nullptr };
+
+    void release() noexcept;
+public:
+    TickerBatch(std::vector<std::string> tickers, std::vector<TickerSeries> series, void* batch, ReleaseBatchFunction release);
+
+    ~TickerBatch();
+    TickerBatch(const TickerBatch&) = delete;
+    TickerBatch& operator=(const TickerBatch&) = delete;
+    TickerBatch(TickerBatch&& other) noexcept;
+    TickerBatch& operator=(TickerBatch&& other) noexcept;
+
+    // getters
+    const std::vector<std::string>& getTickers() const;
+    std::size_t size() const;
+    Eigen::Map<const Eigen::VectorXd> getLogReturns(std::size_t index) const;
+    Eigen::Map<const Eigen::VectorXd> getClosePrices(std::size_t index) const;
+};
+
+// Handle of an import plugin (dlopen). The plugin keeps its state (e.g. one Python interpreter with the provider
+// module imported once) for the whole process: it is never unloaded, opening it again is cheap.
+// Errors (missing library or symbol, failed fetch) throw std::runtime_error with the path and the message of the plugin.
+class ImportPlugin
+{
+private:
+    std::string s_path;
+    FetchTickersFunction p_fetch_tickers{ nullptr };
+    ReleaseBatchFunction p_release_batch{ nullptr };
+public:
+    explicit ImportPlugin(const std::string& path);
+
+    // getters
+    const std::string& getPath() const;
+
+    // fetch the series of all the tickers in one call
+    TickerBatch fetchTickers(const std::vector<std::string>& tickers) const;
+};
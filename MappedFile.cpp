@@ -0,0 +1,184 @@
+#include "MappedFile.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    [[noreturn]] void throwSystemError(const std::string& what, const std::string& path)
+    {
+        throw std::runtime_error("MappedFile: " + what + " " + path + ": " + std::strerror(errno));
+    }
+
+    // closes the descriptor when the mapping is done or on error: the mapping stays valid without it
+    struct FileDescriptor
+    {
+        int fd{ -1 };
+        ~FileDescriptor() { if (fd >= 0) { ::close(fd); } }
+    };
+}
+
+MappedFile::MappedFile(const std::string& path)
+    : s_path{ path }
+{
+    FileDescriptor file{ ::open(path.c_str(), O_RDONLY) };
+    if (file.fd < 0)
+    {
+        throwSystemError("can't open", path);
+    }
+
+    struct stat status{};
+    if (::fstat(file.fd, &status) != 0)
+    {
+        throwSystemError("can't stat", path);
+    }
+    i_size = static_cast<std::size_t>(status.st_size);
+
+    // an empty file has nothing to map: data() is nullptr and size() is 0
+    if (i_size > 0)
+    {
+        void* address = ::mmap(nullptr, i_size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+        if (address == MAP_FAILED)
+        {
+            throwSystemError("can't map", path);
+        }
+        p_data = static_cast<std::byte*>(address);
+    }
+}
+
+MappedFile MappedFile::create(const std::string& path, const std::size_t size)
+{
+    FileDescriptor file{ ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) };
+    if (file.fd < 0)
+    {
+        throwSystemError("can't create", path);
+    }
+    if (::ftruncate(file.fd, static_cast<off_t>(size)) != 0)
+    {
+        throwSystemError("can't resize", path);
+    }
+
+    MappedFile mapped;
+    mapped.s_path = path;
+    mapped.i_size = size;
+    mapped.b_writable = true;
+    if (size > 0)
+    {
+        void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+        if (address == MAP_FAILED)
+        {
+            throwSystemError("can't map", path);
+        }
+        mapped.p_data = static_cast<std::byte*>(address);
+    }
+    return mapped;
+}
+
+MappedFile MappedFile::openWritable(const std::string& path)
+{
+    FileDescriptor file{ ::open(path.c_str(), O_RDWR) };
+    if (file.fd < 0)
+    {
+        throwSystemError("can't open", path);
+    }
+
+    struct stat status{};
+    if (::fstat(file.fd, &status) != 0)
+    {
+        throwSystemError("can't stat", path);
+    }
+
+    MappedFile mapped;
+    mapped.s_path = path;
+    mapped.i_size = static_cast<std::size_t>(status.st_size);
+    mapped.b_writable = true;
+    if (mapped.i_size > 0)
+    {
+        void* address = ::mmap(nullptr, mapped.i_size, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+        if (address == MAP_FAILED)
+        {
+            throwSystemError("can't map", path);
+        }
+        mapped.p_data = static_cast<std::byte*>(address);
+    }
+    return mapped;
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : s_path{ std::move(other.s_path) }
+    , p_data{ std::exchange(other.p_data, nullptr) }
+    , i_size{ std::exchange(other.i_size, 0) }
+    , b_writable{ std::exchange(other.b_writable, false) }
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        s_path = std::move(other.s_path);
+        p_data = std::exchange(other.p_data, nullptr);
+        i_size = std::exchange(other.i_size, 0);
+        b_writable = std::exchange(other.b_writable, false);
+    }
+    return *this;
+}
+
+void MappedFile::unmap() noexcept
+{
+    if (p_data != nullptr)
+    {
+        ::munmap(p_data, i_size);
+        p_data = nullptr;
+    }
+    i_size = 0;
+}
+
+// getters
+const std::string& MappedFile::getPath() const
+{
+    return s_path;
+}
+std::size_t MappedFile::size() const
+{
+    return i_size;
+}
+bool MappedFile::isWritable() const
+{
+    return b_writable;
+}
+const std::byte* MappedFile::data() const
+{
+    return p_data;
+}
+std::byte* MappedFile::writableData()
+{
+    if (!b_writable)
+    {
+        throw std::logic_error("MappedFile: " + s_path + " is mapped read-only.");
+    }
+    return p_data;
+}
+std::span<const std::byte> MappedFile::bytes() const
+{
+    return { p_data, i_size };
+}
+
+void MappedFile::flush()
+{
+    if (b_writable && p_data != nullptr && ::msync(p_data, i_size, MS_SYNC) != 0)
+    {
+        throwSystemError("can't sync", s_path);
+    }
+}
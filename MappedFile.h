@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <string>
+
+// RAII memory mapping of a whole file (POSIX mmap): the pages are loaded by the OS on first access, nothing is copied
+// Errors (missing file, mmap failure) throw std::runtime_error with the path and the system message
+class MappedFile
+{
+private:
+    std::string s_path;
+    std::byte* p_data{ nullptr };
+    std::size_t i_size{};
+    bool b_writable{ false };
+
+    void unmap() noexcept;
+public:
+    MappedFile() = default;
+    // map an existing file read-only
+    explicit MappedFile(const std::string& path);
+    // create (or truncate) a file of the given size and map it read-write: the writes go to the file
+    static MappedFile create(const std::string& path, std::size_t size);
+    // map an existing file read-write: the writes go to the file, its size doesn't change
+    static MappedFile openWritable(const std::string& path);
+
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // getters
+    const std::string& getPath() const;
+    std::size_t size() const;
+    bool isWritable() const;
+    const std::byte* data() const;
+    // throws std::logic_error if the file is mapped read-only
+    std::byte* writableData();
+    std::span<const std::byte> bytes() const;
+
+    // write the modified pages back to the file (msync): the destructor only schedules them
+    void flush();
+};
@@ -0,0 +1,358 @@
+#include "MarketDataStore.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace
+{
+    constexpr std::array<char, 8> MAGIC { 'M', 'C', 'V', 'A', 'R', 'M', 'D', 'S' };
+    constexpr std::size_t ALIGNMENT { 64 };
+    constexpr std::size_t TICKER_SLOT { MarketDataStore::MAX_TICKER_LENGTH + 1 };
+
+    struct StoreHeader
+    {
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t ticker_count;
+        std::uint64_t day_count;
+        std::uint64_t day_capacity;
+        std::uint64_t dates_offset;
+        std::uint64_t prices_offset;
+        std::uint64_t returns_offset;
+        // doubles between the starts of two return columns
+        std::uint64_t column_stride;
+        // MissingDates used to align the csv files
+        std::uint32_t missing_dates;
+        // rows read from the end of every csv file, 0 for the whole history
+        std::uint32_t lookback;
+        // MarketDataStore::sourceHash() of the csv files, 0 for none
+        std::uint64_t source_hash;
+    };
+    static_assert(sizeof(StoreHeader) == 80);
+
+    std::size_t alignUp(const std::size_t value, const std::size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // one slot of last prices: the two slots are a cache line apart at least
+    std::size_t pricesSlotSize(const std::size_t ticker_count)
+    {
+        return alignUp(ticker_count * sizeof(double), ALIGNMENT);
+    }
+
+    // the slot published with a day count
+    std::size_t pricesSlotOffset(const StoreHeader& header, const std::size_t day_count)
+    {
+        return header.prices_offset + (day_count % 2) * pricesSlotSize(header.ticker_count);
+    }
+
+    // the day count is written last by append(): it publishes the new row and the new price slot
+    std::uint64_t loadDayCount(const std::byte* data)
+    {
+        auto* day_count = reinterpret_cast<std::uint64_t*>(const_cast<std::byte*>(data + offsetof(StoreHeader, day_count)));
+        return std::atomic_ref<std::uint64_t>(*day_count).load(std::memory_order_acquire);
+    }
+
+    void storeDayCount(std::byte* data, const std::uint64_t day_count)
+    {
+        auto* stored = reinterpret_cast<std::uint64_t*>(data + offsetof(StoreHeader, day_count));
+        std::atomic_ref<std::uint64_t>(*stored).store(day_count, std::memory_order_release);
+    }
+
+    // header of a store with these dimensions, the file size is returns_offset + tickers * stride doubles
+    StoreHeader makeHeader(const std::size_t ticker_count, const std::size_t day_count, const std::size_t day_capacity,
+        const MissingDates missing_dates, const std::size_t lookback)
+    {
+        StoreHeader header{};
+        header.magic = MAGIC;
+        header.version = MarketDataStore::VERSION;
+        header.ticker_count = static_cast<std::uint32_t>(ticker_count);
+        header.day_count = day_count;
+        header.day_capacity = day_capacity;
+        header.dates_offset = alignUp(sizeof(StoreHeader) + ticker_count * TICKER_SLOT, ALIGNMENT);
+        header.prices_offset = alignUp(header.dates_offset + day_capacity * sizeof(std::int32_t), ALIGNMENT);
+        header.returns_offset = alignUp(header.prices_offset + 2 * pricesSlotSize(ticker_count), ALIGNMENT);
+        header.column_stride = alignUp(day_capacity, ALIGNMENT / sizeof(double));
+        header.missing_dates = static_cast<std::uint32_t>(missing_dates);
+        header.lookback = static_cast<std::uint32_t>(lookback);
+        return header;
+    }
+
+    std::size_t fileSize(const StoreHeader& header)
+    {
+        return header.returns_offset + header.ticker_count * header.column_stride * sizeof(double);
+    }
+}
+
+MarketDataStore::MarketDataStore(const std::string& path)
+    : m_file{ path }
+{
+    StoreHeader header{};
+    if (m_file.size() < sizeof(header))
+    {
+        throw std::runtime_error("MarketDataStore: " + path + " is not a market data store.");
+    }
+    std::memcpy(&header, m_file.data(), sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION)
+    {
+        throw std::runtime_error("MarketDataStore: " + path + " is not a market data store of version " + std::to_string(VERSION) + ".");
+    }
+    const StoreHeader expected = makeHeader(header.ticker_count, header.day_count, header.day_capacity, MissingDates::Drop, 0);
+    if (header.day_count > header.day_capacity || header.returns_offset != expected.returns_offset
+        || header.column_stride != expected.column_stride || header.missing_dates > static_cast<std::uint32_t>(MissingDates::Pairwise)
+        || m_file.size() < fileSize(header))
+    {
+        throw std::runtime_error("MarketDataStore: " + path + " is truncated or corrupted.");
+    }
+
+    e_missing_dates = static_cast<MissingDates>(header.missing_dates);
+    i_lookback = header.lookback;
+    i_day_count = header.day_count;
+    i_day_capacity = header.day_capacity;
+    i_column_stride = header.column_stride;
+    i_dates_offset = header.dates_offset;
+    i_returns_offset = header.returns_offset;
+    i_source_hash = header.source_hash;
+
+    // an append may run while the file is opened: the prices are copied from the slot of the day count, and copied
+    // again if the day count has moved meanwhile (the slot could have been reused by the append after the next one)
+    v_last_prices.resize(header.ticker_count);
+    for (std::uint64_t day_count = loadDayCount(m_file.data()); ; )
+    {
+        std::memcpy(v_last_prices.data(), m_file.data() + pricesSlotOffset(header, day_count), header.ticker_count * sizeof(double));
+        const std::uint64_t published = loadDayCount(m_file.data());
+        if (published == day_count || published > i_day_capacity)
+        {
+            i_day_count = day_count;
+            break;
+        }
+        day_count = published;
+    }
+
+    const auto* slots = reinterpret_cast<const char*>(m_file.data() + sizeof(header));
+    for (std::size_t i = 0; i < header.ticker_count; ++i)
+    {
+        const char* slot = slots + i * TICKER_SLOT;
+        v_tickers.emplace_back(slot, strnlen(slot, MAX_TICKER_LENGTH));
+    }
+}
+
+void MarketDataStore::create(const std::string& path, const std::vector<std::string>& tickers, const std::span<const std::int32_t> dates,
+    const Eigen::Ref<const Eigen::MatrixXd>& returns, const Eigen::VectorXd& last_prices, const MissingDates missing_dates,
+    const std::size_t lookback, std::size_t day_capacity, const std::uint64_t source_hash)
+{
+    const auto day_count = static_cast<std::size_t>(returns.rows());
+    if (static_cast<std::size_t>(returns.cols()) != tickers.size() || static_cast<std::size_t>(last_prices.size()) != tickers.size()
+        || dates.size() != day_count)
+    {
+        throw std::invalid_argument("MarketDataStore: tickers, dates, returns and prices have different sizes.");
+    }
+    for (const auto& ticker : tickers)
+    {
+        if (ticker.size() > MAX_TICKER_LENGTH)
+        {
+            throw std::invalid_argument("MarketDataStore: ticker " + ticker + " is too long.");
+        }
+    }
+    if (day_capacity == 0)
+    {
+        day_capacity = day_count + 256;
+    }
+    day_capacity = std::max(day_capacity, day_count);
+
+    StoreHeader header = makeHeader(tickers.size(), day_count, day_capacity, missing_dates, lookback);
+    header.source_hash = source_hash;
+    const std::string temporary_path = path + ".tmp";
+    {
+        MappedFile file = MappedFile::create(temporary_path, fileSize(header));
+        std::byte* data = file.writableData();
+
+        // the file is created with zeros: the ticker names are NUL-padded and the spare capacity stays 0
+        std::memcpy(data, &header, sizeof(header));
+        for (std::size_t i = 0; i < tickers.size(); ++i)
+        {
+            std::memcpy(data + sizeof(header) + i * TICKER_SLOT, tickers[i].data(), tickers[i].size());
+        }
+        std::memcpy(data + header.dates_offset, dates.data(), day_count * sizeof(std::int32_t));
+        std::memcpy(data + pricesSlotOffset(header, day_count), last_prices.data(), tickers.size() * sizeof(double));
+
+        auto* columns = reinterpret_cast<double*>(data + header.returns_offset);
+        for (std::size_t j = 0; j < tickers.size(); ++j)
+        {
+            Eigen::Map<Eigen::VectorXd>(columns + j * header.column_stride, returns.rows()) = returns.col(static_cast<Eigen::Index>(j));
+        }
+        file.flush();
+    }
+
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary_path.c_str());
+        throw std::runtime_error("MarketDataStore: can't write " + path);
+    }
+}
+
+void MarketDataStore::buildFromCsv(const std::string& path, const std::vector<std::string>& tickers, const std::vector<std::string>& csv_paths,
+    ThreadPool& pool, const MissingDates missing_dates, const std::size_t lookback)
+{
+    const ReturnData data = loadReturnData(csv_paths, pool, missing_dates, lookback);
+    create(path, tickers, data.dates, data.log_returns, data.last_prices, missing_dates, lookback, 0, sourceHash(csv_paths));
+}
+
+std::uint64_t MarketDataStore::sourceHash(const std::vector<std::string>& csv_paths)
+{
+    namespace fs = std::filesystem;
+
+    // FNV-1a over the bytes of the absolute paths, each one followed by a NUL
+    std::uint64_t hash = 14695981039346656037ull;
+    for (const auto& csv_path : csv_paths)
+    {
+        std::error_code error;
+        fs::path absolute = fs::weakly_canonical(csv_path, error);
+        if (error)
+        {
+            absolute = fs::path(csv_path);
+        }
+        const std::string name = absolute.string();
+        for (const char c : name)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        hash = hash * 1099511628211ull;
+    }
+    return hash;
+}
+
+std::shared_ptr<const MarketDataStore> MarketDataStore::openOrBuild(const std::string& path, const std::vector<std::string>& tickers,
+    const std::vector<std::string>& csv_paths, ThreadPool& pool, const MissingDates missing_dates, const std::size_t lookback)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    const fs::file_time_type store_time = fs::last_write_time(path, error);
+    bool current = !error;
+    for (const auto& csv_path : csv_paths)
+    {
+        current = current && fs::last_write_time(csv_path, error) <= store_time && !error;
+    }
+
+    if (current)
+    {
+        try
+        {
+            auto store = std::make_shared<const MarketDataStore>(path);
+            if (store->getTickers() == tickers && store->getMissingDates() == missing_dates
+                && store->getLookback() == lookback && store->getSourceHash() == sourceHash(csv_paths))
+            {
+                return store;
+            }
+        } catch (const std::runtime_error&) {
+            // an old version or a damaged file is rebuilt
+        }
+    }
+
+    buildFromCsv(path, tickers, csv_paths, pool, missing_dates, lookback);
+    return std::make_shared<const MarketDataStore>(path);
+}
+
+void MarketDataStore::append(const std::string& path, const std::int32_t date, const Eigen::VectorXd& returns, const Eigen::VectorXd& close_prices)
+{
+    // validate with a read-only view first
+    std::size_t day_count;
+    std::size_t day_capacity;
+    MissingDates missing_dates;
+    std::size_t lookback;
+    std::uint64_t source_hash;
+    {
+        const MarketDataStore store(path);
+        if (static_cast<std::size_t>(returns.size()) != store.getTickers().size() || close_prices.size() != returns.size())
+        {
+            throw std::invalid_argument("MarketDataStore: one return and one price per ticker are needed.");
+        }
+        if (store.getDayCount() > 0 && date <= store.getDates().back())
+        {
+            throw std::invalid_argument("MarketDataStore: the appended date must follow the last date of the store.");
+        }
+
+        // full: rewrite the store with twice the capacity, the only case where the file is rewritten
+        if (store.getDayCount() == store.getDayCapacity())
+        {
+            const Eigen::Index days = static_cast<Eigen::Index>(store.getDayCount());
+            Eigen::MatrixXd extended(days + 1, returns.size());
+            extended.topRows(days) = store.getReturns();
+            extended.row(days) = returns.transpose();
+            std::vector<std::int32_t> dates(store.getDates().begin(), store.getDates().end());
+            dates.push_back(date);
+            create(path, store.getTickers(), dates, extended, close_prices, store.getMissingDates(), store.getLookback(),
+                2 * store.getDayCapacity() + 1, store.getSourceHash());
+            return;
+        }
+        day_count = store.getDayCount();
+        day_capacity = store.getDayCapacity();
+        missing_dates = store.getMissingDates();
+        lookback = store.getLookback();
+        source_hash = store.getSourceHash();
+    }
+
+    MappedFile file = MappedFile::openWritable(path);
+    std::byte* data = file.writableData();
+    StoreHeader header = makeHeader(static_cast<std::size_t>(returns.size()), day_count, day_capacity, missing_dates, lookback);
+    header.source_hash = source_hash;
+
+    // the new row and the prices in the slot of the next day count first, the day count last: a reader never sees a
+    // count beyond the written data, and the prices of its own count stay in the other slot
+    std::memcpy(data + header.dates_offset + day_count * sizeof(std::int32_t), &date, sizeof(date));
+    auto* columns = reinterpret_cast<double*>(data + header.returns_offset);
+    for (Eigen::Index j = 0; j < returns.size(); ++j)
+    {
+        columns[static_cast<std::size_t>(j) * header.column_stride + day_count] = returns(j);
+    }
+    std::memcpy(data + pricesSlotOffset(header, day_count + 1), close_prices.data(), static_cast<std::size_t>(close_prices.size()) * sizeof(double));
+    file.flush();
+
+    storeDayCount(data, day_count + 1);
+    file.flush();
+}
+
+// getters
+const std::vector<std::string>& MarketDataStore::getTickers() const
+{
+    return v_tickers;
+}
+std::size_t MarketDataStore::getDayCount() const
+{
+    return i_day_count;
+}
+std::size_t MarketDataStore::getDayCapacity() const
+{
+    return i_day_capacity;
+}
+MissingDates MarketDataStore::getMissingDates() const
+{
+    return e_missing_dates;
+}
+std::size_t MarketDataStore::getLookback() const
+{
+    return i_lookback;
+}
+std::uint64_t MarketDataStore::getSourceHash() const
+{
+    return i_source_hash;
+}
+std::span<const std::int32_t> MarketDataStore::getDates() const
+{
+    return { reinterpret_cast<const std::int32_t*>(m_file.data() + i_dates_offset), i_day_count };
+}
+Eigen::Map<const Eigen::MatrixXd, 0, Eigen::OuterStride<>> MarketDataStore::getReturns() const
+{
+    return { reinterpret_cast<const double*>(m_file.data() + i_returns_offset), static_cast<Eigen::Index>(i_day_count),
+        static_cast<Eigen::Index>(v_tickers.size()), Eigen::OuterStride<>(static_cast<Eigen::Index>(i_column_stride)) };
+}
+const Eigen::VectorXd& MarketDataStore::getLastPrices() const
+{
+    return v_last_prices;
+}
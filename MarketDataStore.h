@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "CsvLoader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+// Binary columnar store of the market data: built once from the csv files, then memory-mapped at start-up
+// Layout (little-endian, every section 64-byte aligned):
+//   header    magic "MCVARMDS", version, ticker count, day count, day capacity, section offsets, column stride,
+//             handling of the missing dates, lookback, hash of the csv paths
+//   tickers   one 32-byte slot per ticker (NUL-padded)
+//   dates     day capacity x int32 (yyyymmdd)
+//   prices    two slots of the last close price of each ticker (double): slot day count % 2 is the current one
+//   returns   one column of day capacity doubles per ticker (log returns), column stride padded to 8 doubles
+// The columns have room for day capacity rows: a daily append writes one value per column and the prices in the
+// other slot, then the day count, which publishes both. The file is only rewritten (with twice the capacity) when it is full.
+class MarketDataStore
+{
+private:
+    MappedFile m_file;
+    std::vector<std::string> v_tickers;
+    MissingDates e_missing_dates{ MissingDates::Drop };
+    std::size_t i_lookback{};
+    std::size_t i_day_count{};
+    std::size_t i_day_capacity{};
+    std::size_t i_column_stride{};
+    std::size_t i_dates_offset{};
+    std::size_t i_returns_offset{};
+    std::uint64_t i_source_hash{};
+    // prices of the day count of this view, copied when it is opened
+    Eigen::VectorXd v_last_prices;
+public:
+    static constexpr std::uint32_t VERSION { 3 };
+    // longest ticker name
+    static constexpr std::size_t MAX_TICKER_LENGTH { 31 };
+
+    // map an existing store read-only: throws std::runtime_error if the file isn't a store of this version
+    explicit MarketDataStore(const std::string& path);
+
+    // write a new store (replacing the file atomically): returns is days x tickers (NaN where missing with
+    // MissingDates::Pairwise), day_capacity 0 leaves room for about one more year of appends
+    // source_hash identifies the csv files the store was built from (sourceHash()), 0 for none
+    static void create(const std::string& path, const std::vector<std::string>& tickers, std::span<const std::int32_t> dates,
+        const Eigen::Ref<const Eigen::MatrixXd>& returns, const Eigen::VectorXd& last_prices,
+        MissingDates missing_dates = MissingDates::Drop, std::size_t lookback = 0, std::size_t day_capacity = 0,
+        std::uint64_t source_hash = 0);
+    // hash of the absolute paths of the csv files, in order
+    static std::uint64_t sourceHash(const std::vector<std::string>& csv_paths);
+    // load and align the csv files in parallel (see loadReturnData()) and write them as a store
+    static void buildFromCsv(const std::string& path, const std::vector<std::string>& tickers, const std::vector<std::string>& csv_paths,
+        ThreadPool& pool, MissingDates missing_dates = MissingDates::Drop, std::size_t lookback = 0);
+    // the store of the tickers, rebuilt from the csv files first when it is missing, has other tickers, was built from
+    // other csv files or aligned with another policy or lookback, or is older than one of the csv files
+    static std::shared_ptr<const MarketDataStore> openOrBuild(const std::string& path, const std::vector<std::string>& tickers,
+        const std::vector<std::string>& csv_paths, ThreadPool& pool, MissingDates missing_dates = MissingDates::Drop,
+        std::size_t lookback = 0);
+    // append one day (after the last date) with the log return and the close price of every ticker: written in place
+    // in the spare capacity of the columns, the readers already open keep seeing their own day count and prices
+    static void append(const std::string& path, std::int32_t date, const Eigen::VectorXd& returns, const Eigen::VectorXd& close_prices);
+
+    // getters: views of the mapped file, valid as long as the store
+    const std::vector<std::string>& getTickers() const;
+    std::size_t getDayCount() const;
+    std::size_t getDayCapacity() const;
+    MissingDates getMissingDates() const;
+    // rows read from the end of every csv file, 0 for the whole history (the appended days come on top)
+    std::size_t getLookback() const;
+    std::uint64_t getSourceHash() const;
+    std::span<const std::int32_t> getDates() const;
+    // days x tickers, the columns are day capacity apart
+    Eigen::Map<const Eigen::MatrixXd, 0, Eigen::OuterStride<>> getReturns() const;
+    // close prices of the last day of this view
+    const Eigen::VectorXd& getLastPrices() const;
+};
@@ -0,0 +1,495 @@
+#include "MonteCarloEngine.h"
+#include "Random.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+MultiEquityEngine::MultiEquityEngine(std::shared_ptr<const CovarianceModel> covariance_model, Eigen::VectorXd drift, Eigen::VectorXd last_price_vector,
+    const std::vector<std::uint16_t> &share_number_vector)
+    : p_covariance_model{std::move(covariance_model)}
+    , v_drift{std::move(drift)}
+    , v_last_price_vector{std::move(last_price_vector)}
+{
+    if (!p_covariance_model || p_covariance_model->getAssetCount() != v_last_price_vector.size() || v_drift.size() != v_last_price_vector.size()
+        || static_cast<Eigen::Index>(share_number_vector.size()) != v_last_price_vector.size())
+    {
+        throw std::invalid_argument("MultiEquityEngine: inputs have different numbers of assets.");
+    }
+
+    v_position_vector.resize(v_last_price_vector.size());
+    for (Eigen::Index j = 0; j < v_last_price_vector.size(); ++j)
+    {
+        v_position_vector(j) = v_last_price_vector(j) * static_cast<double>(share_number_vector[j]);
+    }
+    f_initial_value = v_position_vector.sum();
+}
+
+MultiEquityEngine::MultiEquityEngine(Eigen::MatrixXd cholesky_lower, Eigen::VectorXd drift, Eigen::VectorXd last_price_vector, const std::vector<std::uint16_t> &share_number_vector)
+    : MultiEquityEngine(std::make_shared<CholeskyModel>(std::move(cholesky_lower)), std::move(drift), std::move(last_price_vector), share_number_vector)
+{
+}
+
+// getters
+Eigen::Index MultiEquityEngine::getAssetCount() const
+{
+    return v_last_price_vector.size();
+}
+double MultiEquityEngine::getInitialValue() const
+{
+    return f_initial_value;
+}
+
+namespace
+{
+    // seed of the run: a new one for every run unless the config sets it
+    std::uint64_t resolveSeed(const SimulationConfig& config)
+    {
+        if (config.seed != 0)
+        {
+            return config.seed;
+        }
+        std::random_device rd;
+        return (static_cast<std::uint64_t>(rd()) << 32) | rd();
+    }
+
+    // simulations of a chunk: a multiple of the block size, so that the blocks always start at the same paths and
+    // the results are bitwise identical whatever the chunk size or the thread count
+    std::int64_t chunkSize(const std::int64_t requested, const std::int64_t block_size)
+    {
+        const std::int64_t chunk_size = std::max<std::int64_t>(1, requested);
+        return (chunk_size + block_size - 1) / block_size * block_size;
+    }
+
+    std::int64_t chunkCount(const std::int64_t simulations, const std::int64_t chunk_size)
+    {
+        return (simulations + chunk_size - 1) / chunk_size;
+    }
+
+    // Run the chunks [0, chunk_count) on the pool: a few tasks per worker pull the chunk indices from a shared counter,
+    // so the task queues stay small for any number of chunks
+    void runChunks(ThreadPool& pool, const std::int64_t chunk_count, const std::function<void(std::int64_t)>& run_chunk)
+    {
+        std::atomic<std::int64_t> next_chunk{ 0 };
+        const auto task_count = static_cast<std::size_t>(std::min<std::int64_t>(chunk_count,
+            4 * static_cast<std::int64_t>(pool.getThreadCount() + 1)));
+
+        pool.parallelFor(task_count, [&](std::size_t)
+        {
+            for (std::int64_t chunk = next_chunk.fetch_add(1); chunk < chunk_count; chunk = next_chunk.fetch_add(1))
+            {
+                run_chunk(chunk);
+            }
+        });
+    }
+
+    // normals of the simulations [first_path, first_path + count) at a step, one per simulation
+    // antithetic runs draw one normal z per pair of simulations and give -z to the second one
+    void fillPathNormals(const SimulationConfig& config, const std::uint64_t seed, const std::int64_t first_path, const std::size_t count,
+        const std::uint32_t step, std::vector<double>& normals)
+    {
+        if (!config.antithetic)
+        {
+            Random::fillNormals(seed, static_cast<std::uint64_t>(first_path), count, step, 0, 1, normals.data(), count);
+            return;
+        }
+
+        const std::size_t draws = (count + 1) / 2;
+        Random::fillNormals(seed, static_cast<std::uint64_t>(first_path / 2), draws, step, 0, 1, normals.data(), draws);
+        // spread from the end: normals[i / 2] is read before it's overwritten
+        for (std::size_t i = count; i-- > 0; )
+        {
+            normals[i] = (i % 2 == 0) ? normals[i / 2] : -normals[i / 2];
+        }
+    }
+
+    // the full output of a run must fit in the budget, otherwise the streaming functions have to be used
+    void checkOutputSize(const std::size_t bytes, const SimulationConfig& config, const char* message)
+    {
+        if (bytes > config.memory_budget)
+        {
+            throw std::length_error(message);
+        }
+    }
+}
+
+struct MultiEquityEngine::Workspace
+{
+    // the normals of consecutive days are stacked: rows [t * rows, (t + 1) * rows) hold day t of the block
+    Eigen::MatrixXd normals;
+    Eigen::MatrixXd shocks;
+    // cumulative log return of each simulation and asset: S_T = S_0 * exp(log_returns)
+    Eigen::MatrixXd log_returns;
+    Eigen::VectorXd losses;
+};
+
+ChunkPlan MultiEquityEngine::planRun(const SimulationConfig& config, const std::size_t worker_count, const std::vector<double>& confidence_levels) const
+{
+    ChunkPlan plan;
+    plan.worker_count = std::max<std::size_t>(1, worker_count);
+
+    // block buffers: normals (steps * block x normals per step), shocks (steps * block x assets),
+    // log returns (block x assets) plus the losses
+    const auto n_assets = static_cast<std::size_t>(getAssetCount());
+    const auto n_normals = static_cast<std::size_t>(p_covariance_model->getNormalCount());
+    const auto block_bytes = [n_assets, n_normals](const std::int32_t block_size, const std::int32_t steps)
+    {
+        return static_cast<std::size_t>(block_size) * (static_cast<std::size_t>(steps) * (n_normals + n_assets) + n_assets + 1) * sizeof(double);
+    };
+
+    // the buffers of all the workers take at most half of the budget, the rest is left to the results
+    const std::size_t worker_budget = config.memory_budget / 2 / plan.worker_count;
+    plan.block_size = std::max<std::int32_t>(1, config.block_size);
+    while (plan.block_size > 16 && block_bytes(plan.block_size, 1) > worker_budget)
+    {
+        plan.block_size /= 2;
+    }
+    // antithetic pairs never straddle two blocks: every block starts at an even path
+    if (config.antithetic)
+    {
+        plan.block_size += plan.block_size % 2;
+    }
+
+    // path-dependent runs correlate the shocks of several days with one multiply: as many days as the buffers allow
+    plan.steps_per_block = config.path_dependent ? std::max<std::int32_t>(1, config.trading_days) : 1;
+    while (plan.steps_per_block > 1 && block_bytes(plan.block_size, plan.steps_per_block) > worker_budget)
+    {
+        plan.steps_per_block = (plan.steps_per_block + 1) / 2;
+    }
+    plan.workspace_bytes = block_bytes(plan.block_size, plan.steps_per_block);
+    plan.chunk_size = chunkSize(config.chunk_size, plan.block_size);
+    plan.chunk_count = chunkCount(config.simulations, plan.chunk_size);
+
+    if (!confidence_levels.empty())
+    {
+        // the lowest confidence level has the largest tail, and every worker may see all of it
+        const double min_confidence = *std::min_element(confidence_levels.begin(), confidence_levels.end());
+        const std::size_t tail_bytes = plan.worker_count * tailCount(min_confidence, static_cast<std::size_t>(config.simulations)) * sizeof(double);
+        const std::size_t available = config.memory_budget - std::min(config.memory_budget, plan.worker_count * plan.workspace_bytes);
+
+        plan.exact_tail = tail_bytes <= available;
+        plan.result_bytes = plan.exact_tail ? tail_bytes : plan.worker_count * QuantileSketch().getMaxBytes();
+    }
+
+    return plan;
+}
+
+void MultiEquityEngine::simulateChunk(const SimulationConfig& config, const ChunkPlan& plan, const std::uint64_t seed, const std::int64_t first,
+    const std::int64_t count, Workspace& workspace, const LossCallback& on_losses) const
+{
+    const Eigen::Index n_assets = getAssetCount();
+    const Eigen::Index n_normals = p_covariance_model->getNormalCount();
+    const Eigen::Index block_size = plan.block_size;
+    const double sqrt_dt = std::sqrt(config.dt);
+    const Eigen::RowVectorXd drift_row = v_drift.transpose();
+    const double sqrt_horizon = std::sqrt(config.trading_days * config.dt);
+    const Eigen::RowVectorXd horizon_drift_row = drift_row * static_cast<double>(config.trading_days);
+
+    // Working buffers of one block (simulations x assets, days stacked for the normals and shocks): allocated by the
+    // first chunk of the worker, then reused for every block of every chunk
+    const Eigen::Index stacked_rows = block_size * plan.steps_per_block;
+    if (workspace.normals.rows() != stacked_rows)
+    {
+        workspace.normals.resize(stacked_rows, n_normals);
+        workspace.shocks.resize(stacked_rows, n_assets);
+        workspace.log_returns.resize(block_size, n_assets);
+        workspace.losses.resize(block_size);
+    }
+    Eigen::MatrixXd& normals = workspace.normals;
+    Eigen::MatrixXd& shocks = workspace.shocks;
+    Eigen::MatrixXd& log_returns = workspace.log_returns;
+    Eigen::VectorXd& losses = workspace.losses;
+
+    // antithetic runs: simulation 2p adds the shocks of draw p, simulation 2p + 1 subtracts them (rows of the block
+    // taken every other one): only half of the normals are generated and correlated
+    using EveryOtherRow = Eigen::Map<Eigen::MatrixXd, 0, Eigen::Stride<Eigen::Dynamic, 2>>;
+    const Eigen::Stride<Eigen::Dynamic, 2> every_other_row(log_returns.rows(), 2);
+
+    for (Eigen::Index offset = 0; offset < count; offset += block_size)
+    {
+        const Eigen::Index rows = std::min<Eigen::Index>(block_size, count - offset);
+        auto block_log_returns = log_returns.topRows(rows);
+        block_log_returns.setZero();
+
+        // draws: the rows of normals and shocks of one step, and their counter in the random stream
+        const Eigen::Index draws = config.antithetic ? (rows + 1) / 2 : rows;
+        const auto first_draw = static_cast<std::uint64_t>(config.antithetic ? (first + offset) / 2 : first + offset);
+        const auto add_shocks = [&](const auto& draw_shocks, const double scale)
+        {
+            if (!config.antithetic)
+            {
+                block_log_returns.noalias() += draw_shocks * scale;
+                return;
+            }
+            // the last simulation of an odd run has no mirror
+            EveryOtherRow(log_returns.data(), draws, n_assets, every_other_row).noalias() += draw_shocks * scale;
+            EveryOtherRow(log_returns.data() + 1, rows - draws, n_assets, every_other_row).noalias() -= draw_shocks.topRows(rows - draws) * scale;
+        };
+
+        if (!config.path_dependent)
+        {
+            // only the terminal value is needed: under constant-parameter GBM the sum of the daily log returns is
+            // one correlated normal draw with mean T * drift and covariance T * dt * Sigma
+            Random::fillNormals(seed, first_draw, static_cast<std::size_t>(draws), 0,
+                0, static_cast<std::size_t>(n_normals), normals.data(), static_cast<std::size_t>(normals.rows()));
+
+            p_covariance_model->correlate(normals.topRows(draws), shocks.topRows(draws));
+            add_shocks(shocks.topRows(draws), sqrt_horizon);
+            block_log_returns.rowwise() += horizon_drift_row;
+        } else {
+            for (std::int32_t first_step = 0; first_step < config.trading_days; first_step += plan.steps_per_block)
+            {
+                const std::int32_t steps = std::min(plan.steps_per_block, config.trading_days - first_step);
+
+                // the normals are addressed by (seed, path, step, asset): the result doesn't depend on the chunking
+                // they are written straight into the stacked layout, no copy before the multiply
+                for (std::int32_t t = 0; t < steps; ++t)
+                {
+                    Random::fillNormals(seed, first_draw, static_cast<std::size_t>(draws),
+                        static_cast<std::uint32_t>(first_step + t), 0, static_cast<std::size_t>(n_normals),
+                        normals.data() + t * draws, static_cast<std::size_t>(normals.rows()));
+                }
+
+                // one multiply for all the days of the group: a triangular (steps * rows x N) * (N x N) with the
+                // Cholesky factor, or (steps * rows x K) * (K x N) with the factor loadings
+                p_covariance_model->correlate(normals.topRows(steps * draws), shocks.topRows(steps * draws));
+
+                // GBM steps in log space: S_t = S_t-1 * exp(drift + shock * sqrt(dt))
+                for (std::int32_t t = 0; t < steps; ++t)
+                {
+                    add_shocks(shocks.middleRows(t * draws, draws), sqrt_dt);
+                    block_log_returns.rowwise() += drift_row;
+                }
+            }
+        }
+
+        // value of the portfolio at the end of the horizon and the loss with respect to the initial value
+        losses.head(rows) = (f_initial_value - (block_log_returns.array().exp().matrix() * v_position_vector).array()).matrix();
+        on_losses(first + offset, std::span<const double>(losses.data(), static_cast<std::size_t>(rows)));
+    }
+}
+
+void MultiEquityEngine::simulate(const SimulationConfig& config, const ChunkPlan& plan, ThreadPool& pool, const LossCallback& on_losses) const
+{
+    const std::uint64_t seed = resolveSeed(config);
+    std::vector<Workspace> workspaces(plan.worker_count);
+
+    runChunks(pool, plan.chunk_count, [&](const std::int64_t chunk)
+    {
+        const std::int64_t first = chunk * plan.chunk_size;
+        const std::int64_t count = std::min<std::int64_t>(plan.chunk_size, config.simulations - first);
+        simulateChunk(config, plan, seed, first, count, workspaces[pool.getWorkerIndex()], on_losses);
+    });
+}
+
+void MultiEquityEngine::simulate(const SimulationConfig& config, ThreadPool& pool, const LossCallback& on_losses) const
+{
+    simulate(config, planRun(config, pool.getThreadCount() + 1), pool, on_losses);
+}
+
+Eigen::VectorXd MultiEquityEngine::simulateLosses(const SimulationConfig& config, ThreadPool& pool) const
+{
+    checkOutputSize(static_cast<std::size_t>(config.simulations) * sizeof(double), config,
+        "MultiEquityEngine::simulateLosses: the loss vector doesn't fit in the memory budget.");
+
+    // every block writes its losses in its own segment of the vector
+    Eigen::VectorXd losses(config.simulations);
+    simulate(config, pool, [&losses](const std::int64_t first_path, const std::span<const double> block_losses)
+    {
+        std::copy(block_losses.begin(), block_losses.end(), losses.data() + first_path);
+    });
+
+    return losses;
+}
+
+QuantileSketch MultiEquityEngine::simulateSketch(const SimulationConfig& config, ThreadPool& pool, const double relative_accuracy) const
+{
+    // one sketch per worker (plus the calling thread), merged at the end: no locking while simulating
+    std::vector<QuantileSketch> sketches(pool.getThreadCount() + 1, QuantileSketch(relative_accuracy));
+    simulate(config, pool, [&sketches, &pool](std::int64_t, const std::span<const double> block_losses)
+    {
+        sketches[pool.getWorkerIndex()].add(block_losses);
+    });
+
+    for (std::size_t i = 1; i < sketches.size(); ++i)
+    {
+        sketches[0].merge(sketches[i]);
+    }
+
+    return sketches[0];
+}
+
+TailCollector MultiEquityEngine::simulateTail(const SimulationConfig& config, ThreadPool& pool, const std::vector<double>& confidence_levels) const
+{
+    // the lowest confidence level has the largest tail: it covers all the others
+    const double min_confidence = *std::min_element(confidence_levels.begin(), confidence_levels.end());
+    const std::size_t capacity = tailCount(min_confidence, static_cast<std::size_t>(config.simulations));
+
+    // one collector per worker (plus the calling thread), merged at the end
+    std::vector<TailCollector> collectors(pool.getThreadCount() + 1, TailCollector(capacity));
+    simulate(config, pool, [&collectors, &pool](std::int64_t, const std::span<const double> block_losses)
+    {
+        collectors[pool.getWorkerIndex()].add(block_losses);
+    });
+
+    for (std::size_t i = 1; i < collectors.size(); ++i)
+    {
+        collectors[0].merge(collectors[i]);
+    }
+
+    return collectors[0];
+}
+
+RiskReport MultiEquityEngine::simulateRisk(const SimulationConfig& config, ThreadPool& pool, const std::vector<double>& confidence_levels,
+    const double relative_accuracy) const
+{
+    RiskReport report;
+    report.plan = planRun(config, pool.getThreadCount() + 1, confidence_levels);
+    // antithetic runs also measure how much the mirrored paths reduced the variance (every block starts at an even path)
+    std::vector<AntitheticStatistics> antithetic(report.plan.worker_count);
+
+    // every chunk folds its losses into the results of its worker, the results are merged at the end
+    if (report.plan.exact_tail)
+    {
+        const double min_confidence = *std::min_element(confidence_levels.begin(), confidence_levels.end());
+        std::vector<TailCollector> collectors(report.plan.worker_count,
+            TailCollector(tailCount(min_confidence, static_cast<std::size_t>(config.simulations))));
+        simulate(config, report.plan, pool, [&](std::int64_t, const std::span<const double> block_losses)
+        {
+            collectors[pool.getWorkerIndex()].add(block_losses);
+            if (config.antithetic)
+            {
+                antithetic[pool.getWorkerIndex()].add(block_losses);
+            }
+        });
+
+        for (std::size_t i = 1; i < collectors.size(); ++i)
+        {
+            collectors[0].merge(collectors[i]);
+        }
+        report.measures = collectors[0].computeRiskMeasures(confidence_levels);
+    } else {
+        std::vector<QuantileSketch> sketches(report.plan.worker_count, QuantileSketch(relative_accuracy));
+        simulate(config, report.plan, pool, [&](std::int64_t, const std::span<const double> block_losses)
+        {
+            sketches[pool.getWorkerIndex()].add(block_losses);
+            if (config.antithetic)
+            {
+                antithetic[pool.getWorkerIndex()].add(block_losses);
+            }
+        });
+
+        for (std::size_t i = 1; i < sketches.size(); ++i)
+        {
+            sketches[0].merge(sketches[i]);
+        }
+        for (const double confidence : confidence_levels)
+        {
+            report.measures.push_back({ confidence, sketches[0].getValueAtRisk(confidence), sketches[0].getExpectedShortfall(confidence) });
+        }
+    }
+
+    for (std::size_t i = 1; i < antithetic.size(); ++i)
+    {
+        antithetic[0].merge(antithetic[i]);
+    }
+    report.mean_loss_variance_ratio = antithetic[0].getMeanLossVarianceRatio();
+
+    return report;
+}
+
+SingleEquityEngine::SingleEquityEngine(const std::float_t initial_value, const std::float_t drift, const std::float_t diffusion_coeff)
+    : f_initial_value{ initial_value }
+    , f_drift{ drift }
+    , f_diffusion_coeff{ diffusion_coeff }
+{
+}
+
+PathMatrix SingleEquityEngine::simulatePaths(const SimulationConfig& config, ThreadPool& pool) const
+{
+    const auto rows = static_cast<std::size_t>(config.trading_days) + 1;
+    checkOutputSize(rows * static_cast<std::size_t>(config.simulations) * sizeof(std::float_t), config,
+        "SingleEquityEngine::simulatePaths: the path matrix doesn't fit in the memory budget.");
+
+    const std::uint64_t seed = resolveSeed(config);
+    // antithetic pairs stay in one chunk
+    const std::int64_t chunk_size = chunkSize(config.chunk_size, config.antithetic ? 2 : 1);
+
+    // one allocation for the whole matrix: row [0] is the starting point
+    PathMatrix simulated_prices(rows, static_cast<std::size_t>(config.simulations));
+    std::fill(simulated_prices.row(0).begin(), simulated_prices.row(0).end(), f_initial_value);
+
+    // every chunk fills its own columns, the normals buffer of each worker is reused by all its chunks
+    std::vector<std::vector<double>> normal_buffers(pool.getThreadCount() + 1);
+    runChunks(pool, chunkCount(config.simulations, chunk_size), [&](const std::int64_t chunk)
+    {
+        const std::int64_t first = chunk * chunk_size;
+        const auto count = static_cast<std::size_t>(std::min<std::int64_t>(chunk_size, config.simulations - first));
+
+        std::vector<double>& normals = normal_buffers[pool.getWorkerIndex()];
+        normals.resize(count);
+
+        // Generate normally distributed random prices for rows >= [1]: contiguous segments of two rows
+        for (std::int32_t t = 1; t <= config.trading_days; ++t)
+        {
+            fillPathNormals(config, seed, first, count, static_cast<std::uint32_t>(t - 1), normals);
+
+            const std::float_t* previous = simulated_prices.row(static_cast<std::size_t>(t - 1)).data() + first;
+            std::float_t* current = simulated_prices.row(static_cast<std::size_t>(t)).data() + first;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                current[i] = previous[i] * std::exp(f_drift + f_diffusion_coeff * static_cast<std::float_t>(normals[i]));
+            }
+        }
+    });
+
+    return simulated_prices;
+}
+
+StreamingFanChart SingleEquityEngine::simulateFanChart(const SimulationConfig& config, ThreadPool& pool, const double relative_accuracy) const
+{
+    const std::uint64_t seed = resolveSeed(config);
+    // antithetic pairs stay in one chunk
+    const std::int64_t chunk_size = chunkSize(config.chunk_size, config.antithetic ? 2 : 1);
+    const auto steps = static_cast<std::size_t>(config.trading_days) + 1;
+
+    // one fan chart per worker (plus the calling thread), merged at the end
+    std::vector<StreamingFanChart> fan_charts(pool.getThreadCount() + 1, StreamingFanChart(steps, relative_accuracy));
+    // prices and normals of the current chunk, reused by all the chunks of a worker
+    std::vector<std::vector<std::float_t>> price_buffers(pool.getThreadCount() + 1);
+    std::vector<std::vector<double>> normal_buffers(pool.getThreadCount() + 1);
+
+    runChunks(pool, chunkCount(config.simulations, chunk_size), [&](const std::int64_t chunk)
+    {
+        const std::int64_t first = chunk * chunk_size;
+        const auto count = static_cast<std::size_t>(std::min<std::int64_t>(chunk_size, config.simulations - first));
+        const std::size_t worker = pool.getWorkerIndex();
+        StreamingFanChart& fan_chart = fan_charts[worker];
+
+        // only the current prices of the chunk are kept: same random numbers as simulatePaths()
+        std::vector<std::float_t>& prices = price_buffers[worker];
+        std::vector<double>& normals = normal_buffers[worker];
+        prices.assign(count, f_initial_value);
+        normals.resize(count);
+        fan_chart.add(0, prices);
+
+        for (std::int32_t t = 1; t <= config.trading_days; ++t)
+        {
+            fillPathNormals(config, seed, first, count, static_cast<std::uint32_t>(t - 1), normals);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                prices[i] = prices[i] * std::exp(f_drift + f_diffusion_coeff * static_cast<std::float_t>(normals[i]));
+            }
+            fan_chart.add(static_cast<std::size_t>(t), prices);
+        }
+    });
+
+    for (std::size_t i = 1; i < fan_charts.size(); ++i)
+    {
+        fan_charts[0].merge(fan_charts[i]);
+    }
+
+    return fan_charts[0];
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+#include <Eigen/Dense>
+#include "CovarianceModel.h"
+#include "FanChart.h"
+#include "PathMatrix.h"
+#include "QuantileSketch.h"
+#include "RiskMeasures.h"
+#include "TailCollector.h"
+#include "ThreadPool.h"
+
+// Parameters of a montecarlo run
+struct SimulationConfig
+{
+    // number of montecarlo simulations to run: 64-bit, the run is split in chunks so it isn't limited by the memory
+    std::int64_t simulations{};
+    // days to forecast
+    std::int32_t trading_days{};
+    // daily time step
+    double dt{ 1.0 / 252.0 };
+    // simulations processed together: a block of N x block_size doubles should stay in L1/L2
+    std::int32_t block_size{ 256 };
+    // simulations of one chunk: the unit of work of the workers, rounded up to a multiple of block_size
+    std::int64_t chunk_size{ 8192 };
+    // bytes the run may use for the working buffers and the results (the planner shrinks the blocks and switches
+    // from the exact tail to the quantile sketch to stay below it)
+    std::size_t memory_budget{ std::size_t{ 256 } << 20 };
+    // set it when the intermediate days are needed (path-dependent metrics): otherwise only the terminal value is
+    // simulated and the whole horizon is sampled in one step, TRADING_DAYS times less random numbers and exp()
+    bool path_dependent{ false };
+    // seed of the counter-based generator: the same seed gives the same results whatever the thread count or chunking
+    // 0 draws a new seed from std::random_device
+    std::uint64_t seed{ 0 };
+    // antithetic variates: simulations 2p and 2p + 1 are driven by the normals z and -z (and so by the correlated shocks
+    // L * z and -L * z). Half the random numbers and correlation multiplies; the mean loss of a near-linear portfolio
+    // converges much faster, the VaR and ES gain less
+    bool antithetic{ false };
+};
+
+// How a run is executed: chunk_count chunks of chunk_size simulations pulled by the workers, every worker reuses
+// the same block buffers for all its chunks, so the memory doesn't depend on the number of simulations
+struct ChunkPlan
+{
+    std::int64_t chunk_size{};
+    std::int64_t chunk_count{};
+    // rows of the block buffers: config.block_size, halved until the buffers of all the workers fit in the budget
+    std::int32_t block_size{};
+    // days whose shocks are correlated by one matrix multiply in path-dependent runs (1 for terminal sampling)
+    std::int32_t steps_per_block{};
+    // threads of the pool plus the calling thread
+    std::size_t worker_count{};
+    // block buffers of one worker
+    std::size_t workspace_bytes{};
+    // per-worker results: tail collectors or quantile sketches
+    std::size_t result_bytes{};
+    // true: the worst losses of every worker fit in the budget and VaR/ES are exact, false: quantile sketch
+    bool exact_tail{};
+};
+
+// VaR and ES of a run and the plan that computed them
+struct RiskReport
+{
+    std::vector<RiskMeasure> measures;
+    ChunkPlan plan;
+    // antithetic runs: the variance ratio of the mean loss (see AntitheticStatistics), 1 otherwise
+    double mean_loss_variance_ratio{ 1.0 };
+};
+
+// Receives the losses of a block of simulations [first_path, first_path + losses.size())
+// it is called concurrently from the workers of the pool
+using LossCallback = std::function<void(std::int64_t first_path, std::span<const double> losses)>;
+
+// Fused GBM engine for a portfolio of correlated equities
+// For each block of simulations it draws the normals, applies the Cholesky factor, steps the GBM and
+// computes the portfolio value while the block is still in cache: only the loss vector is stored
+// In path-dependent runs the normals of several days are stacked so that one multiply correlates them all
+// The correlation comes from a CovarianceModel: dense Cholesky factor or low-rank factor model
+class MultiEquityEngine
+{
+private:
+    std::shared_ptr<const CovarianceModel> p_covariance_model;
+    Eigen::VectorXd v_drift;
+    Eigen::VectorXd v_last_price_vector;
+    // last price * number of shares, used for the terminal value of the portfolio
+    Eigen::VectorXd v_position_vector;
+    double f_initial_value{};
+
+    // block buffers of one worker, allocated once and reused by all its chunks
+    struct Workspace;
+
+    // simulate the paths [first, first + count) and pass the losses of every block to the callback
+    void simulateChunk(const SimulationConfig& config, const ChunkPlan& plan, std::uint64_t seed, std::int64_t first, std::int64_t count,
+        Workspace& workspace, const LossCallback& on_losses) const;
+    void simulate(const SimulationConfig& config, const ChunkPlan& plan, ThreadPool& pool, const LossCallback& on_losses) const;
+public:
+    MultiEquityEngine(std::shared_ptr<const CovarianceModel> covariance_model, Eigen::VectorXd drift, Eigen::VectorXd last_price_vector,
+        const std::vector<std::uint16_t> &share_number_vector);
+    // dense covariance given by its lower Cholesky factor
+    MultiEquityEngine(Eigen::MatrixXd cholesky_lower, Eigen::VectorXd drift, Eigen::VectorXd last_price_vector, const std::vector<std::uint16_t> &share_number_vector);
+
+    // getters
+    Eigen::Index getAssetCount() const;
+    // value of the portfolio before the simulations
+    double getInitialValue() const;
+
+    // Split a run in chunks under config.memory_budget; confidence_levels decides whether the exact tail fits
+    ChunkPlan planRun(const SimulationConfig& config, std::size_t worker_count, const std::vector<double>& confidence_levels = {}) const;
+
+    // Simulate the price paths and stream the loss (initial value - final value) of each block of simulations
+    // the chunks of simulations run in parallel on the pool
+    void simulate(const SimulationConfig& config, ThreadPool& pool, const LossCallback& on_losses) const;
+
+    // Simulate the price paths and return the loss of each simulation
+    // throws std::length_error if the loss vector doesn't fit in config.memory_budget: use simulateRisk()
+    Eigen::VectorXd simulateLosses(const SimulationConfig& config, ThreadPool& pool) const;
+
+    // Simulate the price paths and feed the losses to a quantile sketch: memory doesn't grow with the simulations
+    QuantileSketch simulateSketch(const SimulationConfig& config, ThreadPool& pool, double relative_accuracy = 0.001) const;
+
+    // Simulate the price paths and keep only the worst losses needed by the confidence levels
+    // VaR and ES are exact, the memory is (1 - min confidence) of the loss vector
+    TailCollector simulateTail(const SimulationConfig& config, ThreadPool& pool, const std::vector<double>& confidence_levels) const;
+
+    // VaR and ES of any number of simulations: exact with the tail collectors when they fit in config.memory_budget,
+    // otherwise within relative_accuracy with the quantile sketches
+    RiskReport simulateRisk(const SimulationConfig& config, ThreadPool& pool, const std::vector<double>& confidence_levels,
+        double relative_accuracy = 0.001) const;
+};
+
+// GBM engine for a single equity (or a portfolio simulated as one asset): it keeps the whole paths
+class SingleEquityEngine
+{
+private:
+    std::float_t f_initial_value{};
+    std::float_t f_drift{};
+    std::float_t f_diffusion_coeff{};
+public:
+    SingleEquityEngine(std::float_t initial_value, std::float_t drift, std::float_t diffusion_coeff);
+
+    // Simulate the price paths: the matrix size is (trading_days + 1) x simulations (rows x columns),
+    // row [0] is the initial value. The chunks of simulations (columns) run in parallel on the pool
+    // throws std::length_error if the matrix doesn't fit in config.memory_budget: use simulateFanChart()
+    PathMatrix simulatePaths(const SimulationConfig& config, ThreadPool& pool) const;
+
+    // Simulate the same paths as simulatePaths() but only update one quantile sketch per step: the path matrix is never built
+    StreamingFanChart simulateFanChart(const SimulationConfig& config, ThreadPool& pool, double relative_accuracy = 0.001) const;
+};
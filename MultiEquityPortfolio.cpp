@@ -1,10 +1,10 @@
+#include <algorithm>
 #include <string>
 #include <iostream>
+#include <stdexcept>
 #include <utility>
 #include "MultiEquityPortfolio.h"
 
-#include <pybind11/detail/common.h>
-
 MultiEquityPortfolio::MultiEquityPortfolio(Eigen::MatrixXd return_matrix, Eigen::VectorXd last_price_vector, const std::vector<std::string> &tickers_vector, const std::vector<std::uint16_t> &share_number_vector)
     : m_return_matrix{std::move(return_matrix)}
     , v_last_price_vector{std::move(last_price_vector)}
@@ -14,27 +14,54 @@ MultiEquityPortfolio::MultiEquityPortfolio(Eigen::MatrixXd return_matrix, Eigen:
     std::cout << "+++ MultiEquity Portfolio created +++" << "\n";
 }
 
+MultiEquityPortfolio::MultiEquityPortfolio(std::shared_ptr<const MarketDataStore> store, const std::vector<std::uint16_t> &share_number_vector)
+    : v_last_price_vector{store->getLastPrices()}
+    , v_tickers_vector{store->getTickers()}
+    , v_share_number_vector{share_number_vector}
+    , p_store{std::move(store)}
+{
+    std::cout << "+++ MultiEquity Portfolio created +++" << "\n";
+}
+
+void MultiEquityPortfolio::detach()
+{
+    if (p_store)
+    {
+        m_return_matrix = p_store->getReturns();
+        p_store.reset();
+    }
+}
+
 // getters
-Eigen::MatrixXd MultiEquityPortfolio::getReturnMatrix() const
+Eigen::Ref<const Eigen::MatrixXd> MultiEquityPortfolio::getReturnMatrix() const
 {
+    if (p_store)
+    {
+        return p_store->getReturns();
+    }
     return m_return_matrix;
 }
-Eigen::VectorXd MultiEquityPortfolio::getLastPriceVector() const
+const Eigen::VectorXd& MultiEquityPortfolio::getLastPriceVector() const
 {
     return v_last_price_vector;
 }
-std::vector<std::string> MultiEquityPortfolio::getTickers() const
+const std::vector<std::string>& MultiEquityPortfolio::getTickers() const
 {
     return v_tickers_vector;
 }
-std::vector<std::uint16_t> MultiEquityPortfolio::getShareNumberVector() const
+const std::vector<std::uint16_t>& MultiEquityPortfolio::getShareNumberVector() const
 {
     return v_share_number_vector;
 }
+Eigen::Ref<const Eigen::VectorXd> MultiEquityPortfolio::getTickerReturns(const Eigen::Index index) const
+{
+    return getReturnMatrix().col(index);
+}
 
 // setters
 void MultiEquityPortfolio::setReturnMatrix(const Eigen::MatrixXd &return_matrix)
 {
+    p_store.reset();
     m_return_matrix = return_matrix;
 }
 void MultiEquityPortfolio::setLastPriceVector(const Eigen::VectorXd &last_price_vector)
@@ -62,22 +89,108 @@ std::vector<std::string>::const_iterator MultiEquityPortfolio::end() const
 
 Eigen::VectorXd MultiEquityPortfolio::getMean() const
 {
-    const Eigen::VectorXd mean_vector = m_return_matrix.colwise().mean();
+    const Eigen::Ref<const Eigen::MatrixXd> returns = getReturnMatrix();
+    if (returns.hasNaN())
+    {
+        // missing dates (MissingDates::Pairwise): the mean of each ticker over its own days
+        return computePairwiseStatistics(returns, 252.0).mean;
+    }
+    const Eigen::VectorXd mean_vector = returns.colwise().mean();
 
     return mean_vector;
 }
 
-// From the log return matrix extract a vector with the mean values and calculate the annualized Covariance Matrix
+// From the log return matrix calculate the annualized Covariance Matrix
 // do not multiply the mean * 252, otherwise the numbers will be wrong
 Eigen::MatrixXd MultiEquityPortfolio::getReturnCovarianceMatrix() const
 {
-    //Eigen::VectorXd mean_vector = m_return_matrix.colwise().mean();
-    Eigen::VectorXd mean_vector = getMean();
-    Eigen::RowVectorXd mean_row = mean_vector.transpose();
+    if (getReturnMatrix().hasNaN())
+    {
+        return computePairwiseStatistics(getReturnMatrix(), 252.0).covariance;
+    }
+    return computeReturnStatistics(getReturnMatrix(), 252.0).covariance;
+}
+
+ReturnStatistics MultiEquityPortfolio::getReturnStatistics(ThreadPool& pool) const
+{
+    if (getReturnMatrix().hasNaN())
+    {
+        return computePairwiseStatistics(getReturnMatrix(), 252.0);
+    }
+    return computeReturnStatistics(getReturnMatrix(), pool, 252.0);
+}
+
+Eigen::Index MultiEquityPortfolio::getTickerIndex(const std::string& ticker) const
+{
+    const auto it = std::find(v_tickers_vector.begin(), v_tickers_vector.end(), ticker);
+    if (it == v_tickers_vector.end())
+    {
+        throw std::out_of_range("MultiEquityPortfolio: ticker " + ticker + " is not in the portfolio.");
+    }
+    return static_cast<Eigen::Index>(it - v_tickers_vector.begin());
+}
+
+// Same estimator as getReturnCovarianceMatrix() for the covariances of one asset with all the others (itself included)
+// the centered column sums to 0, so the other columns don't need to be centered: X^T * (x - mean)
+Eigen::VectorXd MultiEquityPortfolio::getCovarianceColumn(const Eigen::Index index) const
+{
+    const Eigen::Ref<const Eigen::MatrixXd> returns = getReturnMatrix();
+    if (returns.hasNaN())
+    {
+        // missing dates (MissingDates::Pairwise): the column of computePairwiseStatistics(), each covariance on the
+        // days both tickers have, the sums of the other columns restricted to the days of this one (and conversely)
+        const Eigen::MatrixXd mask = (returns.array() == returns.array()).cast<double>();
+        const Eigen::RowVectorXd means = (mask.array() > 0.0).select(returns, 0.0).colwise().sum().cwiseQuotient(mask.colwise().sum());
+        const Eigen::MatrixXd centered = (mask.array() > 0.0).select(returns.rowwise() - means, 0.0);
+
+        const Eigen::VectorXd pair_counts = mask.transpose() * mask.col(index);
+        if (pair_counts.minCoeff() < 2.0)
+        {
+            throw std::invalid_argument("MultiEquityPortfolio: every pair of assets needs at least 2 common days.");
+        }
+        const Eigen::VectorXd comoment = centered.transpose() * centered.col(index)
+            - ((mask.transpose() * centered.col(index)).array() * (centered.transpose() * mask.col(index)).array() / pair_counts.array()).matrix();
+        return (comoment.array() * 252.0 / (pair_counts.array() - 1.0)).matrix();
+    }
+
+    const Eigen::VectorXd centered_column = returns.col(index).array() - returns.col(index).mean();
+    const Eigen::VectorXd covarianceColumn = (returns.transpose() * centered_column) / static_cast<double>(returns.rows() - 1);
+
+    return covarianceColumn * 252;
+}
+
+void MultiEquityPortfolio::addTicker(const std::string& ticker, const Eigen::VectorXd& returns, const double last_price, const std::uint16_t share_number)
+{
+    if (!v_tickers_vector.empty() && returns.size() != getReturnMatrix().rows())
+    {
+        throw std::invalid_argument("MultiEquityPortfolio: " + ticker + " has a different number of days.");
+    }
+    detach();
+
+    const Eigen::Index n = m_return_matrix.cols();
+    m_return_matrix.conservativeResize(returns.size(), n + 1);
+    m_return_matrix.col(n) = returns;
+    v_last_price_vector.conservativeResize(n + 1);
+    v_last_price_vector(n) = last_price;
+    v_tickers_vector.push_back(ticker);
+    v_share_number_vector.push_back(share_number);
+
+    std::cout << "+++ Added ticker " << ticker << " to the MultiEquity Portfolio" << "\n";
+}
+
+void MultiEquityPortfolio::removeTicker(const std::string& ticker)
+{
+    const Eigen::Index index = getTickerIndex(ticker);
+    detach();
+    const Eigen::Index tail = m_return_matrix.cols() - index - 1;
 
-    const Eigen::MatrixXd centered = m_return_matrix.rowwise() - mean_row;
-    const Eigen::MatrixXd covarianceMatrix = (centered.adjoint() * centered) / static_cast<double>(m_return_matrix.rows() - 1);
-    const Eigen::MatrixXd annualizedCovarianceMatrix = covarianceMatrix * 252;
+    // shift the following columns left, then drop the last one
+    m_return_matrix.middleCols(index, tail) = m_return_matrix.rightCols(tail).eval();
+    m_return_matrix.conservativeResize(Eigen::NoChange, m_return_matrix.cols() - 1);
+    v_last_price_vector.segment(index, tail) = v_last_price_vector.tail(tail).eval();
+    v_last_price_vector.conservativeResize(v_last_price_vector.size() - 1);
+    v_tickers_vector.erase(v_tickers_vector.begin() + index);
+    v_share_number_vector.erase(v_share_number_vector.begin() + index);
 
-    return annualizedCovarianceMatrix;
-}
\ No newline at end of file
+    std::cout << "--- Ticker " << ticker << " removed from the MultiEquity Portfolio" << "\n";
+}
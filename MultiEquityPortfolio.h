@@ -1,8 +1,11 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <vector>
-#include </usr/local/Cellar/eigen/3.4.0_1/include/eigen3/Eigen/Dense>
-#include </usr/local/Cellar/eigen/3.4.0_1/include/eigen3/unsupported/Eigen/CXX11/Tensor>
+#include <Eigen/Dense>
+#include "CovarianceEstimator.h"
+#include "MarketDataStore.h"
+#include "ThreadPool.h"
 
 class MultiEquityPortfolio
 {
@@ -11,16 +14,26 @@ private:
     Eigen::VectorXd v_last_price_vector;
     std::vector<std::string> v_tickers_vector;
     std::vector<std::uint16_t> v_share_number_vector;
+    // when set, the returns are read from the mapped store and m_return_matrix is empty
+    std::shared_ptr<const MarketDataStore> p_store;
+
+    // copy the returns out of the store before they are modified
+    void detach();
 public:
     MultiEquityPortfolio() = default;
 
     MultiEquityPortfolio(Eigen::MatrixXd return_matrix, Eigen::VectorXd last_price_vector, const std::vector<std::string> &tickers_vector, const std::vector<std::uint16_t> &share_number_vector);
+    // the returns stay in the mapped store (no copy) until a ticker is added or removed, the tickers and the last
+    // prices come from the store
+    MultiEquityPortfolio(std::shared_ptr<const MarketDataStore> store, const std::vector<std::uint16_t> &share_number_vector);
 
-    // getters
-    Eigen::MatrixXd getReturnMatrix() const;
-    Eigen::VectorXd getLastPriceVector() const;
-    std::vector<std::string> getTickers() const;
-    std::vector<std::uint16_t> getShareNumberVector() const;
+    // getters: references to the data of the portfolio, nothing is copied
+    Eigen::Ref<const Eigen::MatrixXd> getReturnMatrix() const;
+    const Eigen::VectorXd& getLastPriceVector() const;
+    const std::vector<std::string>& getTickers() const;
+    const std::vector<std::uint16_t>& getShareNumberVector() const;
+    // view of the log returns of one ticker (a column of the return matrix)
+    Eigen::Ref<const Eigen::VectorXd> getTickerReturns(Eigen::Index index) const;
 
     // setters
     void setReturnMatrix(const Eigen::MatrixXd& return_matrix);
@@ -35,7 +48,23 @@ public:
     // Return a vector with the mean values
     Eigen::VectorXd getMean() const;
 
-    // Return annualized covariance matrix
+    // Return annualized covariance matrix (pair by pair when returns are missing, see computePairwiseStatistics())
     Eigen::MatrixXd  getReturnCovarianceMatrix() const;
 
+    // Return the mean vector and the annualized covariance matrix in one pass, by tiles in parallel on the pool:
+    // no copy of the return matrix (see computeReturnStatistics())
+    ReturnStatistics getReturnStatistics(ThreadPool& pool) const;
+
+    // position of a ticker in the columns, throws std::out_of_range if it isn't in the portfolio
+    Eigen::Index getTickerIndex(const std::string& ticker) const;
+    // Return the column of the annualized covariance matrix of one asset, O(days * N) instead of O(days * N^2):
+    // with CholeskyModel::appendAsset() the factor follows the ticker changes without a new decomposition
+    // with missing returns (NaN) each covariance uses the days both tickers have, like getReturnCovarianceMatrix()
+    Eigen::VectorXd getCovarianceColumn(Eigen::Index index) const;
+
+    // add a ticker with its log returns (one per day, same days as the portfolio), last price and number of shares
+    void addTicker(const std::string& ticker, const Eigen::VectorXd& returns, double last_price, std::uint16_t share_number);
+    // remove a ticker and its data: use the index of getTickerIndex() with CholeskyModel::removeAsset()
+    void removeTicker(const std::string& ticker);
+
 };
@@ -0,0 +1,93 @@
+#include "PathMatrix.h"
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    constexpr std::size_t FLOATS_PER_LINE { PathMatrix::ALIGNMENT / sizeof(std::float_t) };
+}
+
+PathMatrix::PathMatrix(const std::size_t rows, const std::size_t columns, const std::float_t value)
+    : i_rows{ rows }
+    , i_columns{ columns }
+    , i_stride{ (columns + FLOATS_PER_LINE - 1) / FLOATS_PER_LINE * FLOATS_PER_LINE }
+{
+    const std::size_t size = std::max<std::size_t>(1, i_rows * i_stride);
+    p_data.reset(static_cast<std::float_t*>(::operator new[](size * sizeof(std::float_t), std::align_val_t{ ALIGNMENT })));
+    std::fill_n(p_data.get(), i_rows * i_stride, value);
+}
+
+PathMatrix::PathMatrix(const PathMatrix& other)
+    : PathMatrix(other.i_rows, other.i_columns)
+{
+    std::copy_n(other.p_data.get(), i_rows * i_stride, p_data.get());
+}
+
+PathMatrix& PathMatrix::operator=(const PathMatrix& other)
+{
+    if (this != &other)
+    {
+        PathMatrix copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+// getters
+std::size_t PathMatrix::getRows() const
+{
+    return i_rows;
+}
+std::size_t PathMatrix::getColumns() const
+{
+    return i_columns;
+}
+std::size_t PathMatrix::getStride() const
+{
+    return i_stride;
+}
+
+std::float_t* PathMatrix::data()
+{
+    return p_data.get();
+}
+const std::float_t* PathMatrix::data() const
+{
+    return p_data.get();
+}
+
+std::float_t& PathMatrix::operator()(const std::size_t step, const std::size_t path)
+{
+    return p_data[step * i_stride + path];
+}
+std::float_t PathMatrix::operator()(const std::size_t step, const std::size_t path) const
+{
+    return p_data[step * i_stride + path];
+}
+
+std::span<std::float_t> PathMatrix::row(const std::size_t step)
+{
+    return { p_data.get() + step * i_stride, i_columns };
+}
+std::span<const std::float_t> PathMatrix::row(const std::size_t step) const
+{
+    return { p_data.get() + step * i_stride, i_columns };
+}
+
+std::span<std::float_t> PathMatrix::lastRow()
+{
+    return row(i_rows - 1);
+}
+std::span<const std::float_t> PathMatrix::lastRow() const
+{
+    return row(i_rows - 1);
+}
+
+PathMatrix::ColumnView<std::float_t> PathMatrix::column(const std::size_t path)
+{
+    return { p_data.get() + path, i_rows, i_stride };
+}
+PathMatrix::ColumnView<const std::float_t> PathMatrix::column(const std::size_t path) const
+{
+    return { p_data.get() + path, i_rows, i_stride };
+}
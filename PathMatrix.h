@@ -0,0 +1,74 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+
+// Simulated paths stored in a single 64-byte aligned allocation: steps x simulations (rows x columns), row-major
+// every row starts on a cache line (the stride is padded to 16 floats), so the loops over a row are contiguous
+// and vectorizable
+class PathMatrix
+{
+public:
+    // view of a column (one simulated path): one element per row, stride elements apart
+    template <typename T>
+    class ColumnView
+    {
+    private:
+        T* p_first{};
+        std::size_t i_size{};
+        std::size_t i_stride{};
+    public:
+        ColumnView(T* first, const std::size_t size, const std::size_t stride)
+            : p_first{ first }, i_size{ size }, i_stride{ stride } {}
+
+        std::size_t size() const { return i_size; }
+        T& operator[](const std::size_t step) const { return p_first[step * i_stride]; }
+    };
+
+    static constexpr std::size_t ALIGNMENT { 64 };
+
+private:
+    struct AlignedDelete
+    {
+        void operator()(std::float_t* data) const { ::operator delete[](data, std::align_val_t{ ALIGNMENT }); }
+    };
+
+    std::size_t i_rows{};
+    std::size_t i_columns{};
+    std::size_t i_stride{};
+    std::unique_ptr<std::float_t[], AlignedDelete> p_data;
+
+public:
+    PathMatrix() = default;
+    PathMatrix(std::size_t rows, std::size_t columns, std::float_t value = 0.0f);
+
+    PathMatrix(const PathMatrix& other);
+    PathMatrix& operator=(const PathMatrix& other);
+    PathMatrix(PathMatrix&&) noexcept = default;
+    PathMatrix& operator=(PathMatrix&&) noexcept = default;
+
+    // getters
+    std::size_t getRows() const;
+    std::size_t getColumns() const;
+    // distance in elements between two rows
+    std::size_t getStride() const;
+
+    std::float_t* data();
+    const std::float_t* data() const;
+
+    std::float_t& operator()(std::size_t step, std::size_t path);
+    std::float_t operator()(std::size_t step, std::size_t path) const;
+
+    // the values of all the simulations at a step
+    std::span<std::float_t> row(std::size_t step);
+    std::span<const std::float_t> row(std::size_t step) const;
+    // the last step of the simulations, without copying it
+    std::span<std::float_t> lastRow();
+    std::span<const std::float_t> lastRow() const;
+
+    // one simulated path
+    ColumnView<std::float_t> column(std::size_t path);
+    ColumnView<const std::float_t> column(std::size_t path) const;
+};
@@ -0,0 +1,187 @@
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <pybind11/pybind11.h>
+#include <pybind11/eigen.h>  // NumPy arrays <-> Eigen::Ref / Eigen::Map without copies
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include <Eigen/Dense>
+#include "CovarianceEstimator.h"
+#include "CovarianceModel.h"
+#include "MonteCarloEngine.h"
+#include "ThreadPool.h"
+
+namespace py = pybind11;
+
+// Python extension module: the VaR engine driven from Python (the reverse of the import plugin, which embeds Python)
+//   engine = mcvar.Engine(returns, last_prices, shares)     returns: days x tickers, a Fortran-ordered float64 array is read in place
+//                                                           anything else (C order, other dtypes, lists) is copied once: see returns_copied
+//   losses = engine.simulate_losses(100_000, 5, seed=42)    NumPy view of the loss vector of the engine (losses.base is its capsule)
+//   risk = engine.risk(1_000_000, 5, [0.95, 0.99])          {"value_at_risk", "expected_shortfall": arrays, "exact", "mean_loss_variance_ratio"}
+// The GIL is released while the engine estimates and simulates: other Python threads keep running.
+namespace
+{
+    // Ito's lemma: same drift as main()
+    constexpr double ITO { 0.5 };
+
+    // one pool for all the engines of the process: a call only hands chunks to threads that already exist, and the
+    // calls of several Python threads can share it (parallelFor never runs the work of another call on the caller)
+    ThreadPool& sharedPool()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    // the engine estimates the covariance from columns: a days x tickers matrix in Fortran order
+    using FortranArray = py::array_t<double, py::array::f_style | py::array::forcecast>;
+
+    // the vector is moved to the heap and owned by the NumPy array (freed with it): nothing is copied
+    py::array_t<double> toNumpy(Eigen::VectorXd&& vector)
+    {
+        auto* owned = new Eigen::VectorXd(std::move(vector));
+        const py::capsule free_when_done(owned, [](void* data) { delete static_cast<Eigen::VectorXd*>(data); });
+        return py::array_t<double>(owned->size(), owned->data(), free_when_done);
+    }
+
+    // covariance model and drift estimated once from the returns, like the multi-ticker branch of main()
+    class PythonEngine
+    {
+    private:
+        double f_dt{};
+        std::size_t i_memory_budget{};
+        bool b_returns_copied{};
+        MultiEquityEngine m_engine;
+
+        static MultiEquityEngine makeEngine(const Eigen::Ref<const Eigen::MatrixXd>& returns, const Eigen::Ref<const Eigen::VectorXd>& last_prices,
+            const std::vector<std::uint16_t>& shares, const Eigen::Index factor_count, const double annualization, const double dt)
+        {
+            if (returns.cols() != last_prices.size() || static_cast<Eigen::Index>(shares.size()) != last_prices.size())
+            {
+                throw std::invalid_argument("mcvar.Engine: returns, last_prices and shares must have one column/value per ticker.");
+            }
+
+            Eigen::VectorXd mean;
+            std::shared_ptr<const CovarianceModel> covariance_model;
+            if (factor_count > 0)
+            {
+                mean = returns.colwise().mean().transpose();
+                covariance_model = std::make_shared<FactorModel>(FactorModel::fromReturns(returns, factor_count, annualization));
+            } else {
+                ReturnStatistics statistics = returns.hasNaN() ? computePairwiseStatistics(returns, annualization)
+                    : computeReturnStatistics(returns, sharedPool(), annualization);
+                covariance_model = std::make_shared<CholeskyModel>(CholeskyModel::fromCovariance(statistics.covariance));
+                mean = std::move(statistics.mean);
+            }
+
+            Eigen::VectorXd drift = (mean.array() - ITO * covariance_model->getVariances().array()) * dt;
+            return MultiEquityEngine(std::move(covariance_model), std::move(drift), Eigen::VectorXd(last_prices), shares);
+        }
+    public:
+        PythonEngine(const Eigen::Ref<const Eigen::MatrixXd>& returns, const Eigen::Ref<const Eigen::VectorXd>& last_prices,
+            const std::vector<std::uint16_t>& shares, const Eigen::Index factor_count, const double annualization, const double dt,
+            const std::size_t memory_budget, const bool returns_copied)
+            : f_dt{ dt }
+            , i_memory_budget{ memory_budget }
+            , b_returns_copied{ returns_copied }
+            , m_engine{ makeEngine(returns, last_prices, shares, factor_count, annualization, dt) }
+        {
+        }
+
+        // getters
+        const MultiEquityEngine& getEngine() const
+        {
+            return m_engine;
+        }
+        bool getReturnsCopied() const
+        {
+            return b_returns_copied;
+        }
+
+        SimulationConfig makeConfig(const std::int64_t simulations, const std::int32_t trading_days, const std::uint64_t seed, const bool path_dependent,
+            const bool antithetic) const
+        {
+            SimulationConfig config;
+            config.simulations = simulations;
+            config.trading_days = trading_days;
+            config.dt = f_dt;
+            config.memory_budget = i_memory_budget;
+            config.path_dependent = path_dependent;
+            config.seed = seed;
+            config.antithetic = antithetic;
+            return config;
+        }
+    };
+}
+
+PYBIND11_MODULE(mcvar, module)
+{
+    module.doc() = "Monte Carlo VaR and Expected Shortfall of a portfolio of correlated equities";
+
+    py::class_<PythonEngine>(module, "Engine")
+        // the arguments are converted with the GIL, the estimation runs without it
+        .def(py::init([](const py::object& returns, const Eigen::Ref<const Eigen::VectorXd>& last_prices, const std::vector<std::uint16_t>& shares,
+                const Eigen::Index factor_count, const double annualization, const double dt, const std::size_t memory_budget)
+            {
+                // the same array when it's already float64 in Fortran order, otherwise a Fortran-ordered copy
+                const FortranArray fortran = FortranArray::ensure(returns);
+                if (!fortran || fortran.ndim() != 2)
+                {
+                    throw std::invalid_argument("mcvar.Engine: returns must be a 2-D float array (days x tickers).");
+                }
+                const bool copied = !fortran.is(returns);
+                const Eigen::Map<const Eigen::MatrixXd> matrix(fortran.data(), fortran.shape(0), fortran.shape(1));
+
+                py::gil_scoped_release release;
+                return std::make_unique<PythonEngine>(matrix, last_prices, shares, factor_count, annualization, dt, memory_budget, copied);
+            }),
+            py::arg("returns"), py::arg("last_prices"), py::arg("shares"), py::arg("factor_count") = 0, py::arg("annualization") = 252.0,
+            py::arg("dt") = 1.0 / 252.0, py::arg("memory_budget") = std::size_t{ 256 } << 20)
+        .def_property_readonly("returns_copied", &PythonEngine::getReturnsCopied,
+            "True when the returns weren't a float64 array in Fortran order and were copied once to build the engine")
+        .def_property_readonly("initial_value", [](const PythonEngine& self) { return self.getEngine().getInitialValue(); })
+        .def_property_readonly("asset_count", [](const PythonEngine& self) { return self.getEngine().getAssetCount(); })
+        .def("simulate_losses", [](const PythonEngine& self, const std::int64_t simulations, const std::int32_t trading_days,
+                const std::uint64_t seed, const bool path_dependent, const bool antithetic)
+            {
+                const SimulationConfig config = self.makeConfig(simulations, trading_days, seed, path_dependent, antithetic);
+                Eigen::VectorXd losses;
+                {
+                    py::gil_scoped_release release;
+                    losses = self.getEngine().simulateLosses(config, sharedPool());
+                }
+                return toNumpy(std::move(losses));
+            },
+            py::arg("simulations"), py::arg("trading_days"), py::arg("seed") = 0, py::arg("path_dependent") = false, py::arg("antithetic") = false,
+            "loss (initial value - final value) of every simulation")
+        .def("risk", [](const PythonEngine& self, const std::int64_t simulations, const std::int32_t trading_days,
+                const std::vector<double>& confidence_levels, const std::uint64_t seed, const bool path_dependent, const bool antithetic)
+            {
+                const SimulationConfig config = self.makeConfig(simulations, trading_days, seed, path_dependent, antithetic);
+                RiskReport report;
+                {
+                    py::gil_scoped_release release;
+                    report = self.getEngine().simulateRisk(config, sharedPool(), confidence_levels);
+                }
+
+                const auto n_levels = static_cast<Eigen::Index>(report.measures.size());
+                Eigen::VectorXd value_at_risk(n_levels);
+                Eigen::VectorXd expected_shortfall(n_levels);
+                for (Eigen::Index i = 0; i < n_levels; ++i)
+                {
+                    value_at_risk(i) = report.measures[static_cast<std::size_t>(i)].value_at_risk;
+                    expected_shortfall(i) = report.measures[static_cast<std::size_t>(i)].expected_shortfall;
+                }
+
+                py::dict result;
+                result["value_at_risk"] = toNumpy(std::move(value_at_risk));
+                result["expected_shortfall"] = toNumpy(std::move(expected_shortfall));
+                result["exact"] = report.plan.exact_tail;
+                result["mean_loss_variance_ratio"] = report.mean_loss_variance_ratio;
+                return result;
+            },
+            py::arg("simulations"), py::arg("trading_days"), py::arg("confidence_levels") = std::vector<double>{ 0.95, 0.99 },
+            py::arg("seed") = 0, py::arg("path_dependent") = false, py::arg("antithetic") = false,
+            "VaR and ES for every confidence level: exact when the worst losses fit in the memory budget, otherwise within 0.1%");
+}
@@ -0,0 +1,207 @@
+#include "QuantileSketch.h"
+#include "RiskMeasures.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+QuantileSketch::QuantileSketch(const double relative_accuracy, const std::size_t max_buckets)
+    : f_relative_accuracy{ relative_accuracy }
+    , f_log_gamma{ std::log((1.0 + relative_accuracy) / (1.0 - relative_accuracy)) }
+    , i_max_buckets{ std::max<std::size_t>(1, max_buckets) }
+{
+    if (relative_accuracy <= 0.0 || relative_accuracy >= 1.0)
+    {
+        throw std::invalid_argument("Relative accuracy must be in (0, 1).");
+    }
+}
+
+// getters
+double QuantileSketch::getRelativeAccuracy() const
+{
+    return f_relative_accuracy;
+}
+std::uint64_t QuantileSketch::getCount() const
+{
+    return i_count;
+}
+std::size_t QuantileSketch::getMaxBytes() const
+{
+    return sizeof(QuantileSketch) + 2 * i_max_buckets * sizeof(std::uint64_t);
+}
+
+std::int32_t QuantileSketch::bucketIndex(const double magnitude) const
+{
+    return static_cast<std::int32_t>(std::ceil(std::log(magnitude) / f_log_gamma));
+}
+
+double QuantileSketch::bucketValue(const std::int32_t index) const
+{
+    // bucket (gamma^(i-1), gamma^i]: 2 gamma^i / (gamma + 1) is at most alpha away from both ends
+    return 2.0 * std::exp(index * f_log_gamma) / (1.0 + std::exp(f_log_gamma));
+}
+
+void QuantileSketch::addToStore(Store& store, std::int32_t index, const std::uint64_t count) const
+{
+    if (store.v_counts.empty())
+    {
+        store.i_min_index = index;
+        store.v_counts.assign(1, 0);
+    }
+
+    // smaller magnitude than the first bucket: extend the store down as far as max_buckets allows,
+    // what doesn't fit is collapsed into the first bucket
+    if (index < store.i_min_index)
+    {
+        const std::size_t room = i_max_buckets - std::min(i_max_buckets, store.v_counts.size());
+        const auto extension = static_cast<std::int32_t>(std::min<std::size_t>(room, static_cast<std::size_t>(store.i_min_index - index)));
+        store.v_counts.insert(store.v_counts.begin(), static_cast<std::size_t>(extension), 0);
+        store.i_min_index -= extension;
+        index = std::max(index, store.i_min_index);
+    }
+
+    const auto max_index = store.i_min_index + static_cast<std::int32_t>(store.v_counts.size()) - 1;
+    if (index > max_index)
+    {
+        store.v_counts.resize(static_cast<std::size_t>(index - store.i_min_index) + 1, 0);
+
+        // too many buckets: collapse the smallest magnitudes into the first kept bucket
+        if (store.v_counts.size() > i_max_buckets)
+        {
+            const std::size_t excess = store.v_counts.size() - i_max_buckets;
+            std::uint64_t collapsed = 0;
+            for (std::size_t i = 0; i <= excess; ++i)
+            {
+                collapsed += store.v_counts[i];
+            }
+            store.v_counts.erase(store.v_counts.begin(), store.v_counts.begin() + static_cast<std::ptrdiff_t>(excess));
+            store.v_counts[0] = collapsed;
+            store.i_min_index += static_cast<std::int32_t>(excess);
+        }
+    }
+
+    store.v_counts[static_cast<std::size_t>(index - store.i_min_index)] += count;
+}
+
+void QuantileSketch::add(const double value)
+{
+    if (value > MIN_VALUE)
+    {
+        addToStore(m_positive, bucketIndex(value), 1);
+    } else if (value < -MIN_VALUE) {
+        addToStore(m_negative, bucketIndex(-value), 1);
+    } else {
+        ++i_zero_count;
+    }
+    ++i_count;
+}
+
+void QuantileSketch::add(const std::span<const double> values)
+{
+    for (const double value : values)
+    {
+        add(value);
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch& other)
+{
+    if (other.f_relative_accuracy != f_relative_accuracy)
+    {
+        throw std::invalid_argument("Only sketches with the same accuracy can be merged.");
+    }
+
+    // from the largest magnitude down: the store grows once and the collapsing works as for single values
+    for (std::size_t i = other.m_positive.v_counts.size(); i-- > 0; )
+    {
+        if (other.m_positive.v_counts[i] != 0)
+        {
+            addToStore(m_positive, other.m_positive.i_min_index + static_cast<std::int32_t>(i), other.m_positive.v_counts[i]);
+        }
+    }
+    for (std::size_t i = other.m_negative.v_counts.size(); i-- > 0; )
+    {
+        if (other.m_negative.v_counts[i] != 0)
+        {
+            addToStore(m_negative, other.m_negative.i_min_index + static_cast<std::int32_t>(i), other.m_negative.v_counts[i]);
+        }
+    }
+    i_zero_count += other.i_zero_count;
+    i_count += other.i_count;
+}
+
+double QuantileSketch::getValueAtRank(const std::uint64_t rank) const
+{
+    if (rank >= i_count)
+    {
+        throw std::out_of_range("Rank is beyond the number of values in the sketch.");
+    }
+
+    // ascending order: negative values from the largest magnitude, then the zeros, then the positive values
+    std::uint64_t seen = 0;
+    for (std::size_t i = m_negative.v_counts.size(); i-- > 0; )
+    {
+        seen += m_negative.v_counts[i];
+        if (seen > rank)
+        {
+            return -bucketValue(m_negative.i_min_index + static_cast<std::int32_t>(i));
+        }
+    }
+
+    seen += i_zero_count;
+    if (seen > rank)
+    {
+        return 0.0;
+    }
+
+    for (std::size_t i = 0; i < m_positive.v_counts.size(); ++i)
+    {
+        seen += m_positive.v_counts[i];
+        if (seen > rank)
+        {
+            return bucketValue(m_positive.i_min_index + static_cast<std::int32_t>(i));
+        }
+    }
+
+    return bucketValue(m_positive.i_min_index + static_cast<std::int32_t>(m_positive.v_counts.size()) - 1);
+}
+
+double QuantileSketch::getValueAtRisk(const double confidence) const
+{
+    if (i_count == 0)
+    {
+        throw std::runtime_error("Sketch is empty.");
+    }
+    return getValueAtRank(i_count - tailCount(confidence, i_count));
+}
+
+double QuantileSketch::getExpectedShortfall(const double confidence) const
+{
+    if (i_count == 0)
+    {
+        throw std::runtime_error("Sketch is empty.");
+    }
+
+    // walk down from the largest value until the tail is complete
+    const std::uint64_t tail = tailCount(confidence, i_count);
+    std::uint64_t remaining = tail;
+    double sum = 0.0;
+
+    auto take = [&](const std::uint64_t count, const double value)
+    {
+        const std::uint64_t taken = std::min(count, remaining);
+        sum += static_cast<double>(taken) * value;
+        remaining -= taken;
+    };
+
+    for (std::size_t i = m_positive.v_counts.size(); i-- > 0 && remaining > 0; )
+    {
+        take(m_positive.v_counts[i], bucketValue(m_positive.i_min_index + static_cast<std::int32_t>(i)));
+    }
+    take(i_zero_count, 0.0);
+    for (std::size_t i = 0; i < m_negative.v_counts.size() && remaining > 0; ++i)
+    {
+        take(m_negative.v_counts[i], -bucketValue(m_negative.i_min_index + static_cast<std::int32_t>(i)));
+    }
+
+    return sum / static_cast<double>(tail);
+}
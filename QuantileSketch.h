@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Streaming, mergeable quantile sketch of a loss distribution (logarithmic buckets, as in DDSketch)
+// A value x is counted in the bucket i = ceil(log(|x|) / log(gamma)), gamma = (1 + alpha) / (1 - alpha), one store
+// for the positive values and one for the negative ones. Memory doesn't depend on the number of values.
+//
+// Error bound: the value returned for a rank differs from the exact order statistic x by at most alpha * |x|
+// (values with |x| < MIN_VALUE are counted as 0, an absolute error below MIN_VALUE). This holds at every rank, so
+// also at the 1% and 5% tails; the ES is the mean of the same estimates, its error is at most alpha * mean(|tail|).
+// When a store reaches max_buckets its smallest magnitudes are collapsed: only the ranks near 0 lose the bound.
+class QuantileSketch
+{
+private:
+    // counts of the buckets [i_min_index, i_min_index + size)
+    struct Store
+    {
+        std::vector<std::uint64_t> v_counts;
+        std::int32_t i_min_index{};
+    };
+
+    double f_relative_accuracy{};
+    double f_log_gamma{};
+    std::size_t i_max_buckets{};
+    Store m_positive;
+    Store m_negative;
+    std::uint64_t i_zero_count{};
+    std::uint64_t i_count{};
+
+    std::int32_t bucketIndex(double magnitude) const;
+    // representative value of a bucket: within alpha of every magnitude in it
+    double bucketValue(std::int32_t index) const;
+    void addToStore(Store& store, std::int32_t index, std::uint64_t count) const;
+public:
+    static constexpr double MIN_VALUE { 1e-9 };
+
+    explicit QuantileSketch(double relative_accuracy = 0.001, std::size_t max_buckets = 16384);
+
+    // getters
+    double getRelativeAccuracy() const;
+    std::uint64_t getCount() const;
+    // memory of the sketch once both stores are full: it never uses more
+    std::size_t getMaxBytes() const;
+
+    void add(double value);
+    void add(std::span<const double> values);
+    // add the values of another sketch with the same accuracy: the result is the sketch of the union
+    void merge(const QuantileSketch& other);
+
+    // estimate of the value at a rank in [0, count) in ascending order
+    double getValueAtRank(std::uint64_t rank) const;
+    // VaR and ES with the same tail definition as computeRiskMeasures(): the worst tailCount(confidence, count) values
+    double getValueAtRisk(double confidence) const;
+    double getExpectedShortfall(double confidence) const;
+};
@@ -0,0 +1,289 @@
+#include "Random.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numbers>
+
+// Runtime CPU dispatch on x86-64 with GCC and Clang (macOS included): the kernel is compiled once per instruction set
+// and the first call picks the best one the CPU supports with __builtin_cpu_supports. Elsewhere (e.g. ARM, where NEON
+// is the baseline) the compiler flags decide the instruction set.
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define RANDOM_CPU_DISPATCH 1
+#else
+#define RANDOM_CPU_DISPATCH 0
+#endif
+
+// the helpers are inlined into every kernel, so each instruction set gets its own vectorized copy of them
+#if defined(__GNUC__) || defined(__clang__)
+#define RANDOM_INLINE inline __attribute__((always_inline))
+#else
+#define RANDOM_INLINE inline
+#endif
+
+namespace
+{
+    // normals computed together: the loops over a batch have a fixed trip count and no branches, so the compiler
+    // turns them into SIMD code (8 doubles per AVX-512 register, 4 per AVX2 register)
+    constexpr std::size_t BATCH { 64 };
+
+    // uniform number in the open interval (0, 1) from the top 52 bits: [1, 2) by filling the mantissa, then shift
+    // it never returns 0, so log() is always finite
+    RANDOM_INLINE double toUniform(const std::uint32_t high, const std::uint32_t low)
+    {
+        const std::uint64_t bits = ((static_cast<std::uint64_t>(high) << 32) | low) >> 12;
+        return std::bit_cast<double>(bits | 0x3FF0000000000000ull) - (1.0 - 0x1.0p-53);
+    }
+
+    // natural log of x in (0, 1): x = 2^e * m with m in [sqrt(2)/2, sqrt(2)), log(m) = 2 atanh((m - 1) / (m + 1))
+    // the series is truncated after s^23 (|s| <= 0.1716): the error is below 1 ulp
+    RANDOM_INLINE double logUnit(const double x)
+    {
+        constexpr double LN2_HI { 6.93147180369123816490e-01 };
+        constexpr double LN2_LO { 1.90821492927058770002e-10 };
+
+        const std::uint64_t bits = std::bit_cast<std::uint64_t>(x);
+        std::uint64_t exponent = bits >> 52;
+        std::uint64_t mantissa_bits = (bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull;
+        // halved by decrementing its exponent: integer arithmetic instead of a branch, so every clone vectorizes
+        const auto high = static_cast<std::uint64_t>(std::bit_cast<double>(mantissa_bits) > std::numbers::sqrt2);
+        mantissa_bits -= high << 52;
+        exponent += high;
+        const double mantissa = std::bit_cast<double>(mantissa_bits);
+        // exact conversion of the exponent field with the 2^52 trick (no int64 -> double instruction in AVX2)
+        const double e = std::bit_cast<double>(exponent | 0x4330000000000000ull) - (0x1.0p52 + 1023.0);
+
+        const double s = (mantissa - 1.0) / (mantissa + 1.0);
+        const double s2 = s * s;
+        double series = 1.0 / 23.0;
+        series = series * s2 + 1.0 / 21.0;
+        series = series * s2 + 1.0 / 19.0;
+        series = series * s2 + 1.0 / 17.0;
+        series = series * s2 + 1.0 / 15.0;
+        series = series * s2 + 1.0 / 13.0;
+        series = series * s2 + 1.0 / 11.0;
+        series = series * s2 + 1.0 / 9.0;
+        series = series * s2 + 1.0 / 7.0;
+        series = series * s2 + 1.0 / 5.0;
+        series = series * s2 + 1.0 / 3.0;
+        const double log_mantissa = 2.0 * s + 2.0 * s * s2 * series;
+
+        return e * LN2_HI + (log_mantissa + e * LN2_LO);
+    }
+
+    // cos(2 pi u) and sin(2 pi u) for u in (0, 1): the quadrant q comes from u, x = 2 pi u - q pi / 2 is in [-pi/4, pi/4]
+    // where the Taylor series up to x^16 is below 1 ulp
+    RANDOM_INLINE void sinCos2Pi(const double u, double& cos_value, double& sin_value)
+    {
+        const double v = 4.0 * u;
+        // v > 0: truncation rounds to the nearest quadrant
+        const auto q = static_cast<std::int32_t>(v + 0.5);
+        const double x = (v - static_cast<double>(q)) * (0.5 * std::numbers::pi);
+        const double x2 = x * x;
+
+        double sin_x = -1.0 / 1307674368000.0;
+        sin_x = sin_x * x2 + 1.0 / 6227020800.0;
+        sin_x = sin_x * x2 - 1.0 / 39916800.0;
+        sin_x = sin_x * x2 + 1.0 / 362880.0;
+        sin_x = sin_x * x2 - 1.0 / 5040.0;
+        sin_x = sin_x * x2 + 1.0 / 120.0;
+        sin_x = sin_x * x2 - 1.0 / 6.0;
+        sin_x = x + x * x2 * sin_x;
+
+        double cos_x = 1.0 / 20922789888000.0;
+        cos_x = cos_x * x2 - 1.0 / 87178291200.0;
+        cos_x = cos_x * x2 + 1.0 / 479001600.0;
+        cos_x = cos_x * x2 - 1.0 / 3628800.0;
+        cos_x = cos_x * x2 + 1.0 / 40320.0;
+        cos_x = cos_x * x2 - 1.0 / 720.0;
+        cos_x = cos_x * x2 + 1.0 / 24.0;
+        cos_x = cos_x * x2 - 0.5;
+        cos_x = 1.0 + x2 * cos_x;
+
+        // rotate by q quarter turns (q = 4 is the same as q = 0) with bit masks instead of branches: odd quadrants swap
+        // sin and cos, cos is negated in quadrants 1 and 2, sin in quadrants 2 and 3
+        const auto quadrant = static_cast<std::uint64_t>(q & 3);
+        const std::uint64_t swap = 0 - (quadrant & 1);
+        const std::uint64_t cos_bits = std::bit_cast<std::uint64_t>(cos_x);
+        const std::uint64_t sin_bits = std::bit_cast<std::uint64_t>(sin_x);
+        const std::uint64_t c = cos_bits ^ ((cos_bits ^ sin_bits) & swap);
+        const std::uint64_t s = sin_bits ^ ((cos_bits ^ sin_bits) & swap);
+        cos_value = std::bit_cast<double>(c ^ (((quadrant + 1) & 2) << 62));
+        sin_value = std::bit_cast<double>(s ^ ((quadrant & 2) << 62));
+    }
+
+    // one batch of normal pairs for the paths [first_path, first_path + BATCH)
+    // the Philox rounds run on the whole batch (structure of arrays), then Box-Muller turns the bits into normals
+    RANDOM_INLINE void normalBatch(const std::uint64_t seed, const std::uint64_t first_path, const std::uint32_t step, const std::uint32_t asset_pair,
+        double (&z0)[BATCH], double (&z1)[BATCH])
+    {
+        std::uint32_t c0[BATCH];
+        std::uint32_t c1[BATCH];
+        std::uint32_t c2[BATCH];
+        std::uint32_t c3[BATCH];
+        for (std::size_t i = 0; i < BATCH; ++i)
+        {
+            const std::uint64_t path = first_path + i;
+            c0[i] = static_cast<std::uint32_t>(path);
+            c1[i] = static_cast<std::uint32_t>(path >> 32);
+            c2[i] = step;
+            c3[i] = asset_pair;
+        }
+
+        // Random::philox4x32() on every lane: the lanes are independent, the rounds are unrolled
+        const std::uint32_t k0 = static_cast<std::uint32_t>(seed);
+        const std::uint32_t k1 = static_cast<std::uint32_t>(seed >> 32);
+        for (std::size_t i = 0; i < BATCH; ++i)
+        {
+            std::uint32_t x0 = c0[i];
+            std::uint32_t x1 = c1[i];
+            std::uint32_t x2 = c2[i];
+            std::uint32_t x3 = c3[i];
+#pragma GCC unroll 10
+            for (std::uint32_t round = 0; round < 10; ++round)
+            {
+                Random::philoxRound(x0, x1, x2, x3, k0 + round * Random::PHILOX_W0, k1 + round * Random::PHILOX_W1);
+            }
+            c0[i] = x0;
+            c1[i] = x1;
+            c2[i] = x2;
+            c3[i] = x3;
+        }
+
+        // Box-Muller: radius from the first uniform, angle from the second
+        for (std::size_t i = 0; i < BATCH; ++i)
+        {
+            const double radius = std::sqrt(-2.0 * logUnit(toUniform(c0[i], c1[i])));
+            double cos_value;
+            double sin_value;
+            sinCos2Pi(toUniform(c2[i], c3[i]), cos_value, sin_value);
+            z0[i] = radius * cos_value;
+            z1[i] = radius * sin_value;
+        }
+    }
+
+    // body of Random::fillNormalPairs(), instantiated by every kernel below
+    RANDOM_INLINE void fillNormalPairsKernel(const std::uint64_t seed, const std::uint64_t first_path, const std::size_t path_count,
+        const std::uint32_t step, const std::uint32_t asset_pair, double* out0, double* out1)
+    {
+        alignas(64) double z0[BATCH];
+        alignas(64) double z1[BATCH];
+
+        // the last batch is computed in full and only the requested values are copied
+        for (std::size_t i = 0; i < path_count; i += BATCH)
+        {
+            normalBatch(seed, first_path + i, step, asset_pair, z0, z1);
+
+            const std::size_t count = std::min(BATCH, path_count - i);
+            if (out0 != nullptr)
+            {
+                std::copy_n(z0, count, out0 + i);
+            }
+            if (out1 != nullptr)
+            {
+                std::copy_n(z1, count, out1 + i);
+            }
+        }
+    }
+
+    using FillNormalPairsFunction = void (*)(std::uint64_t, std::uint64_t, std::size_t, std::uint32_t, std::uint32_t, double*, double*);
+
+    void fillNormalPairsDefault(const std::uint64_t seed, const std::uint64_t first_path, const std::size_t path_count, const std::uint32_t step,
+        const std::uint32_t asset_pair, double* out0, double* out1)
+    {
+        fillNormalPairsKernel(seed, first_path, path_count, step, asset_pair, out0, out1);
+    }
+
+#if RANDOM_CPU_DISPATCH
+    __attribute__((target("avx2")))
+    void fillNormalPairsAvx2(const std::uint64_t seed, const std::uint64_t first_path, const std::size_t path_count, const std::uint32_t step,
+        const std::uint32_t asset_pair, double* out0, double* out1)
+    {
+        fillNormalPairsKernel(seed, first_path, path_count, step, asset_pair, out0, out1);
+    }
+
+    __attribute__((target("avx512f")))
+    void fillNormalPairsAvx512(const std::uint64_t seed, const std::uint64_t first_path, const std::size_t path_count, const std::uint32_t step,
+        const std::uint32_t asset_pair, double* out0, double* out1)
+    {
+        fillNormalPairsKernel(seed, first_path, path_count, step, asset_pair, out0, out1);
+    }
+#endif
+
+    // widest kernel the CPU runs
+    FillNormalPairsFunction selectFillNormalPairs()
+    {
+#if RANDOM_CPU_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return fillNormalPairsAvx512;
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return fillNormalPairsAvx2;
+        }
+#endif
+        return fillNormalPairsDefault;
+    }
+}
+
+void Random::fillNormalPairs(const std::uint64_t seed, const std::uint64_t first_path, const std::size_t path_count, const std::uint32_t step,
+    const std::uint32_t asset_pair, double* out0, double* out1)
+{
+    // chosen once, on the first call (thread-safe static initialization)
+    static const FillNormalPairsFunction fill = selectFillNormalPairs();
+    fill(seed, first_path, path_count, step, asset_pair, out0, out1);
+}
+
+std::array<double, 2> Random::normalPair(const std::uint64_t seed, const std::uint64_t path, const std::uint32_t step, const std::uint32_t asset_pair)
+{
+    // last batch computed by this thread, keyed by its address
+    struct Buffer
+    {
+        bool b_valid{ false };
+        std::uint64_t i_seed{};
+        std::uint64_t i_first_path{};
+        std::uint32_t i_step{};
+        std::uint32_t i_asset_pair{};
+        alignas(64) double z0[BATCH];
+        alignas(64) double z1[BATCH];
+    };
+    thread_local Buffer buffer;
+
+    const std::uint64_t first_path = path & ~static_cast<std::uint64_t>(BATCH - 1);
+    if (!buffer.b_valid || buffer.i_seed != seed || buffer.i_first_path != first_path || buffer.i_step != step || buffer.i_asset_pair != asset_pair)
+    {
+        fillNormalPairs(seed, first_path, BATCH, step, asset_pair, buffer.z0, buffer.z1);
+        buffer.b_valid = true;
+        buffer.i_seed = seed;
+        buffer.i_first_path = first_path;
+        buffer.i_step = step;
+        buffer.i_asset_pair = asset_pair;
+    }
+
+    return { buffer.z0[path - first_path], buffer.z1[path - first_path] };
+}
+
+void Random::fillNormals(const std::uint64_t seed, const std::uint64_t first_path, const std::size_t path_count, const std::uint32_t step,
+    const std::uint32_t first_asset, const std::size_t asset_count, double* out, const std::size_t ld)
+{
+    for (std::size_t j = 0; j < asset_count; )
+    {
+        const std::uint32_t asset = first_asset + static_cast<std::uint32_t>(j);
+        double* column = out + j * ld;
+
+        if (asset % 2 == 1)
+        {
+            // odd asset at the start of the block: second value of its pair
+            fillNormalPairs(seed, first_path, path_count, step, asset / 2, nullptr, column);
+            j += 1;
+        } else if (j + 1 < asset_count) {
+            // even asset with its neighbour in the block: one Philox call fills both columns
+            fillNormalPairs(seed, first_path, path_count, step, asset / 2, column, column + ld);
+            j += 2;
+        } else {
+            fillNormalPairs(seed, first_path, path_count, step, asset / 2, column, nullptr);
+            j += 1;
+        }
+    }
+}
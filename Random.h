@@ -1,17 +1,64 @@
 #pragma once
-#include <vector>
-#include <random>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 
 // Generate random numbers normally distributed
 namespace Random
 {
-    inline std::random_device rd;  // Seed for random number engine
-    inline std::mt19937 gen(rd()); // Mersenne Twister engine
-    inline std::normal_distribution<std::float_t> normal_dist(0.0, 1.0); // Normal distribution
+    // Philox4x32 multipliers and Weyl key increments
+    constexpr std::uint32_t PHILOX_M0 { 0xD2511F53 };
+    constexpr std::uint32_t PHILOX_M1 { 0xCD9E8D57 };
+    constexpr std::uint32_t PHILOX_W0 { 0x9E3779B9 };
+    constexpr std::uint32_t PHILOX_W1 { 0xBB67AE85 };
 
-    inline std::float_t getNormalRandom()
+    // one Philox round on the counter (x0, x1, x2, x3) with the round key (k0, k1)
+    // shared by philox4x32() and the vectorized bulk generator, which runs it on a batch of counters
+    inline void philoxRound(std::uint32_t& x0, std::uint32_t& x1, std::uint32_t& x2, std::uint32_t& x3,
+        const std::uint32_t k0, const std::uint32_t k1)
     {
-        return normal_dist(gen); // Generate a random number
+        const std::uint64_t product0 = static_cast<std::uint64_t>(PHILOX_M0) * x0;
+        const std::uint64_t product1 = static_cast<std::uint64_t>(PHILOX_M1) * x2;
+        x0 = static_cast<std::uint32_t>(product1 >> 32) ^ x1 ^ k0;
+        x1 = static_cast<std::uint32_t>(product1);
+        x2 = static_cast<std::uint32_t>(product0 >> 32) ^ x3 ^ k1;
+        x3 = static_cast<std::uint32_t>(product0);
     }
 
+    // Counter-based generator Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+    // The output is a pure function of (counter, key): any thread can generate any part of the stream, in any order
+    inline std::array<std::uint32_t, 4> philox4x32(std::array<std::uint32_t, 4> counter, const std::array<std::uint32_t, 2> key)
+    {
+        for (std::uint32_t round = 0; round < 10; ++round)
+        {
+            philoxRound(counter[0], counter[1], counter[2], counter[3], key[0] + round * PHILOX_W0, key[1] + round * PHILOX_W1);
+        }
+
+        return counter;
+    }
+
+    // Two independent N(0, 1) numbers addressed by (seed, path, step, asset pair) with the Box-Muller transform
+    // asset pair k holds the normals of the assets 2k and 2k + 1
+    // Served from a per-thread buffer of the 64 paths around path (filled by fillNormalPairs()), so walking the paths
+    // in order costs one batch per 64 calls; the values are the same as the bulk generator's
+    std::array<double, 2> normalPair(std::uint64_t seed, std::uint64_t path, std::uint32_t step, std::uint32_t asset_pair);
+
+    // The N(0, 1) number of an asset at a step of a path
+    inline double normal(const std::uint64_t seed, const std::uint64_t path, const std::uint32_t step, const std::uint32_t asset)
+    {
+        return normalPair(seed, path, step, asset / 2)[asset % 2];
+    }
+
+    // Bulk generator: out0[i], out1[i] = normalPair(seed, first_path + i, step, asset_pair) for i in [0, path_count)
+    // out1 can be nullptr when only the even asset is needed
+    // The kernel is vectorized (AVX-512, AVX2 or scalar, chosen at run time) and every value is computed by the same
+    // code whatever its position in the batch, so the results don't depend on the chunking or the thread count
+    void fillNormalPairs(std::uint64_t seed, std::uint64_t first_path, std::size_t path_count, std::uint32_t step,
+        std::uint32_t asset_pair, double* out0, double* out1);
+
+    // Fill a block of normals in bulk: out(i, j) = normal(seed, first_path + i, step, first_asset + j)
+    // out is column-major (paths x assets) with leading dimension ld >= path_count
+    void fillNormals(std::uint64_t seed, std::uint64_t first_path, std::size_t path_count, std::uint32_t step,
+        std::uint32_t first_asset, std::size_t asset_count, double* out, std::size_t ld);
+
 };
@@ -0,0 +1,128 @@
+#include "RiskMeasures.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+std::size_t tailCount(const double confidence, const std::size_t n)
+{
+    if (confidence <= 0.0 || confidence >= 1.0)
+    {
+        throw std::invalid_argument("Confidence level must be in (0, 1).");
+    }
+
+    // the small offset keeps e.g. (1 - 0.95) * 1000 = 50.000000000000004 from rounding up to 51
+    const auto count = static_cast<std::size_t>(std::ceil((1.0 - confidence) * static_cast<double>(n) - 1e-9));
+    return std::clamp<std::size_t>(count, 1, n);
+}
+
+std::vector<RiskMeasure> computeRiskMeasures(std::span<double> losses, const std::vector<double>& confidence_levels)
+{
+    if (losses.empty())
+    {
+        throw std::runtime_error("Loss vector is empty.");
+    }
+
+    const std::size_t n = losses.size();
+    std::vector<RiskMeasure> result(confidence_levels.size());
+
+    // visit the levels from the largest tail to the smallest: each selection only works on the tail of the previous one
+    std::vector<std::size_t> order(confidence_levels.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](const std::size_t a, const std::size_t b)
+        { return confidence_levels[a] < confidence_levels[b]; });
+
+    std::vector<std::size_t> starts(order.size());
+    std::size_t begin = 0;
+    for (std::size_t k = 0; k < order.size(); ++k)
+    {
+        // after the selection [start, n) holds the worst losses and losses[start] is the smallest of them
+        const std::size_t start = n - tailCount(confidence_levels[order[k]], n);
+        std::nth_element(losses.begin() + begin, losses.begin() + start, losses.end());
+        starts[k] = start;
+        begin = start;
+
+        // read it now: the next selections reorder [start, n)
+        result[order[k]].confidence = confidence_levels[order[k]];
+        result[order[k]].value_at_risk = losses[start];
+    }
+
+    // ES: sum the tails from the smallest one, every segment is added only once
+    double tail_sum = 0.0;
+    std::size_t end = n;
+    for (std::size_t k = order.size(); k-- > 0; )
+    {
+        tail_sum = std::accumulate(losses.begin() + starts[k], losses.begin() + end, tail_sum);
+        end = starts[k];
+
+        result[order[k]].expected_shortfall = tail_sum / static_cast<double>(n - starts[k]);
+    }
+
+    return result;
+}
+
+namespace
+{
+    double sampleVariance(const std::uint64_t count, const double sum, const double sum_squares)
+    {
+        const auto n = static_cast<double>(count);
+        return std::max(0.0, (sum_squares - sum * sum / n) / (n - 1.0));
+    }
+}
+
+template <typename T>
+void AntitheticStatistics::addLosses(const std::span<const T> losses)
+{
+    for (const T value : losses)
+    {
+        const auto loss = static_cast<double>(value);
+        f_sum += loss;
+        f_sum_squares += loss * loss;
+    }
+    i_count += losses.size();
+
+    // the last path of an odd run has no mirror
+    for (std::size_t i = 0; i + 1 < losses.size(); i += 2)
+    {
+        const double pair_mean = 0.5 * (static_cast<double>(losses[i]) + static_cast<double>(losses[i + 1]));
+        f_pair_sum += pair_mean;
+        f_pair_sum_squares += pair_mean * pair_mean;
+    }
+    i_pair_count += losses.size() / 2;
+}
+
+void AntitheticStatistics::add(const std::span<const double> losses)
+{
+    addLosses(losses);
+}
+
+void AntitheticStatistics::add(const std::span<const std::float_t> losses)
+{
+    addLosses(losses);
+}
+
+void AntitheticStatistics::merge(const AntitheticStatistics& other)
+{
+    i_count += other.i_count;
+    f_sum += other.f_sum;
+    f_sum_squares += other.f_sum_squares;
+    i_pair_count += other.i_pair_count;
+    f_pair_sum += other.f_pair_sum;
+    f_pair_sum_squares += other.f_pair_sum_squares;
+}
+
+// getters
+double AntitheticStatistics::getMeanLossVarianceRatio() const
+{
+    if (i_pair_count < 2)
+    {
+        return 1.0;
+    }
+
+    const double pair_variance = sampleVariance(i_pair_count, f_pair_sum, f_pair_sum_squares);
+    if (pair_variance <= 0.0)
+    {
+        return 1.0;
+    }
+    return sampleVariance(i_count, f_sum, f_sum_squares) / (2.0 * pair_variance);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Value at Risk and Expected Shortfall of a loss distribution at one confidence level
+// losses are positive when the portfolio loses value
+struct RiskMeasure
+{
+    // confidence level in (0, 1), e.g. 0.95
+    double confidence{};
+    // the smallest loss of the worst tailCount(confidence, n) scenarios
+    double value_at_risk{};
+    // the average loss of the worst tailCount(confidence, n) scenarios
+    double expected_shortfall{};
+};
+
+// number of scenarios beyond the confidence level: ceil((1 - confidence) * n), at least 1
+std::size_t tailCount(double confidence, std::size_t n);
+
+// VaR and ES for every confidence level in one pass over the loss buffer
+// the losses are partially reordered in place (std::nth_element), nothing is copied: O(n) on average
+// the results are in the same order as confidence_levels
+std::vector<RiskMeasure> computeRiskMeasures(std::span<double> losses, const std::vector<double>& confidence_levels);
+
+// Mean-loss variance ratio of antithetic simulations: paths 2p and 2p + 1 are driven by the shocks z and -z
+// Var(loss) / (2 * Var(pair mean)) is the number of independent pairs of simulations that give the standard error of one
+// antithetic pair for the mean loss: large for a near-linear portfolio (the mirrored paths cancel the linear part),
+// 1 when they don't help. It says nothing of the VaR and ES estimators, whose gain in the tail is much smaller
+// the spans must start at an even path; accumulators fed by different threads are merged at the end
+class AntitheticStatistics
+{
+private:
+    std::uint64_t i_count{};
+    double f_sum{};
+    double f_sum_squares{};
+    std::uint64_t i_pair_count{};
+    double f_pair_sum{};
+    double f_pair_sum_squares{};
+
+    template <typename T>
+    void addLosses(std::span<const T> losses);
+public:
+    void add(std::span<const double> losses);
+    void add(std::span<const std::float_t> losses);
+    void merge(const AntitheticStatistics& other);
+
+    // getters
+    // 1 when there are less than 2 pairs or the pair means don't vary
+    double getMeanLossVarianceRatio() const;
+};
@@ -0,0 +1,82 @@
+#include "TailCollector.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+TailCollector::TailCollector(const std::size_t capacity)
+    : i_capacity{ std::max<std::size_t>(1, capacity) }
+{
+    v_heap.reserve(i_capacity);
+}
+
+// getters
+std::size_t TailCollector::getCapacity() const
+{
+    return i_capacity;
+}
+std::uint64_t TailCollector::getCount() const
+{
+    return i_count;
+}
+
+void TailCollector::add(const double loss)
+{
+    ++i_count;
+    if (v_heap.size() < i_capacity)
+    {
+        v_heap.push_back(loss);
+        std::push_heap(v_heap.begin(), v_heap.end(), std::greater<>{});
+    } else if (loss > v_heap.front()) {
+        // replace the smallest of the worst losses
+        std::pop_heap(v_heap.begin(), v_heap.end(), std::greater<>{});
+        v_heap.back() = loss;
+        std::push_heap(v_heap.begin(), v_heap.end(), std::greater<>{});
+    }
+}
+
+void TailCollector::add(const std::span<const double> losses)
+{
+    for (const double loss : losses)
+    {
+        add(loss);
+    }
+}
+
+void TailCollector::merge(const TailCollector& other)
+{
+    // the counts are added separately: add() would count the other tail twice
+    const std::uint64_t count = i_count + other.i_count;
+    add(other.v_heap);
+    i_count = count;
+}
+
+std::vector<RiskMeasure> TailCollector::computeRiskMeasures(const std::vector<double>& confidence_levels) const
+{
+    if (i_count == 0)
+    {
+        throw std::runtime_error("Tail collector is empty.");
+    }
+
+    // the worst losses in descending order
+    std::vector<double> tail = v_heap;
+    std::sort(tail.begin(), tail.end(), std::greater<>{});
+
+    std::vector<RiskMeasure> result;
+    for (const double confidence : confidence_levels)
+    {
+        const std::size_t count = tailCount(confidence, static_cast<std::size_t>(i_count));
+        if (count > tail.size())
+        {
+            throw std::out_of_range("Confidence level needs more losses than the tail collector keeps.");
+        }
+
+        double sum = 0.0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            sum += tail[i];
+        }
+        result.push_back({ confidence, tail[count - 1], sum / static_cast<double>(count) });
+    }
+
+    return result;
+}
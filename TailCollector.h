@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "RiskMeasures.h"
+
+// Keeps only the worst k losses of a stream (a min-heap of size k) and the number of values seen
+// With k = tailCount(confidence, simulations) the VaR and ES at that confidence are exact, and so are the ones at
+// every higher confidence level. Collectors fed by different threads are merged at the end.
+class TailCollector
+{
+private:
+    std::size_t i_capacity{};
+    // min-heap: front() is the smallest of the worst losses, the threshold a new loss has to beat
+    std::vector<double> v_heap;
+    std::uint64_t i_count{};
+public:
+    explicit TailCollector(std::size_t capacity);
+
+    // getters
+    std::size_t getCapacity() const;
+    std::uint64_t getCount() const;
+
+    void add(double loss);
+    void add(std::span<const double> losses);
+    void merge(const TailCollector& other);
+
+    // VaR and ES with the same definitions as computeRiskMeasures() on the full loss vector
+    // throws if a level needs more losses than the capacity
+    std::vector<RiskMeasure> computeRiskMeasures(const std::vector<double>& confidence_levels) const;
+};
@@ -0,0 +1,210 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace
+{
+    // pool and index of the worker running on this thread
+    thread_local const ThreadPool* tl_pool{ nullptr };
+    thread_local std::size_t tl_worker_index{ 0 };
+}
+
+ThreadPool::ThreadPool(std::size_t thread_count)
+{
+    if (thread_count == 0)
+    {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // one queue per worker: the tasks submitted from outside the pool are spread over them
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        v_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        v_threads.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        b_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& thread : v_threads)
+    {
+        thread.join();
+    }
+}
+
+std::size_t ThreadPool::getThreadCount() const
+{
+    return v_threads.size();
+}
+
+std::size_t ThreadPool::getWorkerIndex() const
+{
+    return tl_pool == this ? tl_worker_index : getThreadCount();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    // a worker keeps the tasks it creates, the others are spread round-robin
+    std::size_t index = getWorkerIndex();
+    if (index == getThreadCount())
+    {
+        index = i_next_queue.fetch_add(1, std::memory_order_relaxed) % getThreadCount();
+    }
+
+    {
+        // the counter changes with the queue, under its lock: a thief can't take the task before it is counted
+        std::lock_guard<std::mutex> lock(v_queues[index]->mutex);
+        v_queues[index]->tasks.push_back(std::move(task));
+        ++i_pending;
+    }
+    {
+        // a worker checks the counter under the sleep mutex: once it is released here, the worker either has seen the
+        // new count or is already waiting, so it can't miss the wake-up
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+    }
+    m_wake.notify_one();
+}
+
+bool ThreadPool::tryRunTask(const std::size_t index)
+{
+    std::function<void()> task;
+
+    // own queue first (LIFO: the data is still in cache), then steal the oldest task of the others
+    for (std::size_t k = 0; k < v_queues.size() && !task; ++k)
+    {
+        WorkerQueue& queue = *v_queues[(index + k) % v_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+        {
+            continue;
+        }
+        if (k == 0)
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        --i_pending;
+    }
+
+    if (!task)
+    {
+        return false;
+    }
+
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(const std::size_t index)
+{
+    tl_pool = this;
+    tl_worker_index = index;
+
+    while (true)
+    {
+        if (tryRunTask(index))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_wake.wait(lock, [this] { return b_stop || i_pending > 0; });
+        if (b_stop && i_pending == 0)
+        {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallelFor(const std::size_t count, const std::function<void(std::size_t)>& task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // state shared by the tasks of this call: the indices are claimed from a counter, so the calling thread only
+    // ever runs the work of its own call (the slot getThreadCount() of its per-worker buffers is never shared with
+    // another caller), and a task queued after the last index has been claimed returns without touching task
+    struct Batch
+    {
+        const std::function<void(std::size_t)>* task{};
+        std::size_t count{};
+        std::atomic<std::size_t> next{ 0 };
+        std::mutex mutex;
+        std::condition_variable done;
+        std::size_t remaining{};
+        std::exception_ptr error;
+
+        // run the next index of the call: false when all of them have been claimed
+        bool runNext()
+        {
+            const std::size_t i = next.fetch_add(1);
+            if (i >= count)
+            {
+                return false;
+            }
+
+            try
+            {
+                (*task)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0)
+            {
+                done.notify_all();
+            }
+            return true;
+        }
+    };
+    auto batch = std::make_shared<Batch>();
+    batch->task = &task;
+    batch->count = count;
+    batch->remaining = count;
+
+    // one task per worker at most: each of them runs indices until there are none left
+    const std::size_t task_count = std::min(count, getThreadCount());
+    for (std::size_t k = 0; k < task_count; ++k)
+    {
+        submit([batch]
+        {
+            while (batch->runNext())
+            {
+            }
+        });
+    }
+
+    // the calling thread helps with the indices of this call only, then waits for the ones still running
+    while (batch->runNext())
+    {
+    }
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->done.wait(lock, [&batch] { return batch->remaining == 0; });
+
+    if (batch->error)
+    {
+        std::rethrow_exception(batch->error);
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Reusable pool of worker threads with work stealing
+// Every worker owns a queue: it pops its own tasks from the back and, when it runs out of work,
+// it steals from the front of the other queues
+class ThreadPool
+{
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> v_queues;
+    std::vector<std::thread> v_threads;
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+    // number of tasks sitting in the queues, updated under the lock of the queue that holds the task
+    std::atomic<std::size_t> i_pending{ 0 };
+    std::atomic<std::size_t> i_next_queue{ 0 };
+    bool b_stop{ false };
+
+    void workerLoop(std::size_t index);
+    // pop a task from the queue of the worker or steal one from the others: false if all the queues are empty
+    bool tryRunTask(std::size_t index);
+public:
+    // thread_count = 0 uses all the cores
+    explicit ThreadPool(std::size_t thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t getThreadCount() const;
+    // index of the calling worker in [0, getThreadCount()), getThreadCount() for a thread outside the pool
+    std::size_t getWorkerIndex() const;
+
+    // queue a task: it runs on one of the workers
+    void submit(std::function<void()> task);
+
+    // run task(i) for i in [0, count) and wait for all of them: the calling thread helps with the work of this call
+    // (never with the tasks of other calls), so several threads outside the pool can call it at the same time
+    // the first exception thrown by a task is rethrown here
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& task);
+};
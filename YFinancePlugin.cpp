@@ -0,0 +1,131 @@
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <pybind11/embed.h>  // Pybind11 for embedding Python
+#include <pybind11/numpy.h>  // buffer protocol: the arrays of the provider are read in place
+#include "ImportPlugin.h"
+
+namespace py = pybind11;
+
+// Import plugin with an embedded Python interpreter: the only part of the program that links Python (built with
+// MCVAR_WITH_PYTHON). The interpreter is started once per process and the provider module is imported once: its
+// fetch(tickers) returns {ticker: (log_returns, close_prices)} with two 1-D arrays of the same days per ticker.
+// MCVAR_PROVIDER_MODULE names the provider module (e.g. a stand-in serving canned data), yfinance is the default.
+namespace
+{
+    // default provider: all the tickers in one yfinance download
+    constexpr const char* YFINANCE_PROVIDER = R"(
+import numpy as np
+import yfinance as yf
+
+def fetch(tickers):
+    prices = yf.download(list(tickers), start="2024-01-01", end="2025-01-01", progress=False)
+    print("Stock prices downloaded")
+
+    series = {}
+    for ticker in tickers:
+        close = prices["Close"][ticker].dropna()
+        # daily log returns, the first day has none
+        log_returns = np.log(close / close.shift(1)).dropna()
+        series[ticker] = (log_returns.to_numpy(dtype=np.float64), close.iloc[1:].to_numpy(dtype=np.float64))
+    return series
+)";
+
+    // float64 and contiguous: ensure() returns the same array (no copy) when the provider already gives one
+    using DoubleArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+    // the arrays of one fetch, alive until mcvar_release_batch()
+    struct Batch
+    {
+        std::vector<DoubleArray> arrays;
+    };
+
+    std::once_flag interpreter_started;
+
+    void startInterpreter()
+    {
+        std::call_once(interpreter_started, []
+        {
+            py::initialize_interpreter();
+            // the GIL is released: every call takes it back with gil_scoped_acquire, from any thread
+            PyEval_SaveThread();
+        });
+    }
+
+    // fetch() of the provider, imported on the first call (with the GIL held)
+    py::object& providerFetch()
+    {
+        // never destroyed: releasing it would need the interpreter after the end of main()
+        static py::object* fetch = []
+        {
+            const char* module_name = std::getenv("MCVAR_PROVIDER_MODULE");
+            if (module_name != nullptr && *module_name != '\0')
+            {
+                return new py::object(py::module_::import(module_name).attr("fetch"));
+            }
+            py::dict scope;
+            py::exec(YFINANCE_PROVIDER, scope);
+            return new py::object(scope["fetch"]);
+        }();
+        return *fetch;
+    }
+}
+
+extern "C" __attribute__((visibility("default")))
+int mcvar_fetch_tickers(const char* const* tickers, const std::size_t count, TickerSeries* series, void** batch,
+    char* error, const std::size_t error_size)
+{
+    try
+    {
+        startInterpreter();
+    } catch (const std::exception& exception) {
+        std::snprintf(error, error_size, "can't start Python: %s", exception.what());
+        return 1;
+    }
+
+    py::gil_scoped_acquire gil;
+    try
+    {
+        py::list names;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            names.append(tickers[i]);
+        }
+        const py::object result = providerFetch()(names);
+
+        auto fetched = std::make_unique<Batch>();
+        fetched->arrays.reserve(2 * count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const py::tuple pair = result[py::str(tickers[i])];
+            DoubleArray log_returns = DoubleArray::ensure(py::object(pair[0]));
+            DoubleArray close_prices = DoubleArray::ensure(py::object(pair[1]));
+            if (!log_returns || !close_prices || log_returns.ndim() != 1 || close_prices.ndim() != 1 || log_returns.size() != close_prices.size())
+            {
+                throw std::runtime_error(std::string(tickers[i]) + ": the provider must return two 1-D float arrays of the same length");
+            }
+
+            series[i] = { log_returns.data(), close_prices.data(), static_cast<std::size_t>(log_returns.size()) };
+            fetched->arrays.push_back(std::move(log_returns));
+            fetched->arrays.push_back(std::move(close_prices));
+        }
+
+        *batch = fetched.release();
+        return 0;
+    } catch (const std::exception& exception) {
+        std::snprintf(error, error_size, "%s", exception.what());
+        return 1;
+    }
+}
+
+extern "C" __attribute__((visibility("default")))
+void mcvar_release_batch(void* batch)
+{
+    py::gil_scoped_acquire gil;
+    delete static_cast<Batch*>(batch);
+}
@@ -1,41 +1,50 @@
 #include "functions.h"
 #include "Equity.h"
+#include "CsvLoader.h"
+#include "ImportPlugin.h"
+#include <cmath>
 #include <iostream>
 #include <vector>
-#include <fstream>
-#include <sstream>
-#include </usr/local/Cellar/eigen/3.4.0_1/include/eigen3/Eigen/Dense>
-#include <algorithm>  // For sorting
+#include <Eigen/Dense>
+#include <algorithm>  // For selection
 #include <stdexcept>  // For exception handling
-#include <pybind11/embed.h>  // Pybind11 for embedding Python
 
-namespace py = pybind11;
-
-// worst case out of the last simulation with a level of confidence: it returns a scalar
-std::float_t percentile(const std::vector<std::float_t>& data, const std::float_t percent)
+// worst case out of the last simulation with a level of confidence, the data is reordered in place
+std::float_t percentileInPlace(const std::span<std::float_t> data, const std::float_t percent)
 {
     if (data.empty())
     {
         throw std::runtime_error("Data vector is empty.");
     }
 
-    std::vector<std::float_t> sorted_data = data;  // Copy data to avoid modifying the original
-    std::sort(sorted_data.begin(), sorted_data.end());  // Sort the data
+    // Compute the index corresponding to the percentile: in double, a float can't hold the index of more than 2^24
+    // simulations and rounds it up past the last element
+    const double index = (static_cast<double>(percent) / 100.0) * static_cast<double>(data.size() - 1);
+    const auto lower_idx = std::min(static_cast<std::size_t>(index), data.size() - 1);  // Integer part
+    const auto fraction = static_cast<std::float_t>(index - static_cast<double>(lower_idx));  // Fractional part
 
-    // Compute the index corresponding to the percentile
-    std::float_t index = (percent / 100.0f) * (sorted_data.size() - 1);
-    const std::uint16_t lower_idx = static_cast<int>(index);  // Integer part
-    const std::float_t fraction = index - lower_idx;      // Fractional part
+    // Partial selection instead of a full sort: only the two values around the index are needed
+    const auto lower = data.begin() + lower_idx;
+    std::nth_element(data.begin(), lower, data.end());
 
     // Linear interpolation for better accuracy
-    if (lower_idx + 1 < sorted_data.size())
+    if (lower_idx + 1 < data.size())
     {
-        return sorted_data[lower_idx] + fraction * (sorted_data[lower_idx + 1] - sorted_data[lower_idx]);
+        // the next value in sorted order is the smallest one after the selected element
+        const std::float_t upper = *std::min_element(lower + 1, data.end());
+        return *lower + fraction * (upper - *lower);
     } else {
-        return sorted_data[lower_idx];  // If at the last index, just return the value
+        return *lower;  // If at the last index, just return the value
     }
 };
 
+// worst case out of the last simulation with a level of confidence: it returns a scalar
+std::float_t percentile(const std::vector<std::float_t>& data, const std::float_t percent)
+{
+    std::vector<std::float_t> selected_data = data;  // Copy data to avoid modifying the original
+    return percentileInPlace(selected_data, percent);
+};
+
 std::vector<float> percentile_2D(const std::vector<std::vector<float>>& data, float percent)
 {
     std::vector<float> result;
@@ -53,128 +62,102 @@ std::vector<float> percentile_2D(const std::vector<std::vector<float>>& data, fl
     return result;
 };
 
-// import data for one ticker and return an Equity
-Equity importOneTicker(const std::string& ticker_name, const std::uint16_t& share_no)
+std::vector<float> percentile_2D(PathMatrix& data, float percent)
 {
-    // WARNING: using pybind11 to embed python works properly, but
-    // it makes the code non-portable
-    // use CSV files to load data instead
-    py::scoped_interpreter guard{};  // Start Python interpreter
-    py::module_ np = py::module_::import("numpy");
-    py::module_ yf = py::module_::import("yfinance");
-
-    const py::dict GLOBALS;  // Create a namespace to store the python variables
-    GLOBALS["ticker"] = ticker_name;
-    GLOBALS["share"] = share_no;
-
-    // instantiate an equity with the default constructor
-    Equity eq; // stack allocation
-
-    py::exec(R"(
-        import yfinance as yf
-        import numpy as np
-        stock = yf.download(ticker, start="2024-01-01", end="2025-01-01");
-        print("Stock prices downloaded");
-
-        # Calculate daily log returns and remove missing values
-        stock["Returns"] = stock['Close'] / stock['Close'].shift(1);
-        stock['Log Returns'] = np.log(stock['Close'] / stock['Close'].shift(1));
-        stock = stock.dropna();
-
-        # estimate mean and volatility
-        mu = stock['Log Returns'].mean();
-        sigma = stock['Log Returns'].std();
-
-        # extract the Close price at the end of the time period
-        all_S = stock["Close"].values.tolist()
-        S0 = round(all_S[-1][0], 3)
-
-        )", GLOBALS);
-
-        const auto MU = GLOBALS["mu"].cast<std::float_t>();
-        const auto SIGMA = GLOBALS["sigma"].cast<std::float_t>();
-        const auto S0 = GLOBALS["S0"].cast<std::float_t>();
-        const auto SHARES = GLOBALS["share"].cast<std::uint16_t>();
-        const auto TICKER_NAME = GLOBALS["ticker"].cast<std::string>();
-
-    // set member variables for the equity
-    eq.setTicker(TICKER_NAME);
-    eq.setShareNumber(SHARES);
-    eq.setPrice(S0);
-    eq.setMu(MU);
-    eq.setSigma(SIGMA);
-
-    return eq;
+    std::vector<float> result;
+
+    for (std::size_t t = 0; t < data.getRows(); ++t)
+    {
+        if (data.getColumns() > 0)
+        {
+            result.push_back(percentileInPlace(data.row(t), percent));
+        } else {
+            result.push_back(0.0f); // Handle empty row
+        }
+    }
+
+    return result;
 };
 
-// Function to read Log Returns and Close Prices from a CSV file
-//std::vector<double> readLogReturns(const std::string& filename)
-std::pair<std::vector<double>, std::vector<double>> readLogReturns(const std::string& filename)
+// mean and sample standard deviation of the daily log returns: the same estimates for the csv files and the plugin
+Equity calibrateEquity(const std::string& ticker_name, const std::uint16_t& share_no, const Eigen::Ref<const Eigen::VectorXd>& log_returns, const double last_price)
 {
-    std::ifstream file(filename);
-    if (!file.is_open())
+    if (log_returns.size() < 2)
     {
-        std::cerr << "Failed to open file: " << filename << '\n';
-        return {};
+        throw std::runtime_error("Not enough log returns for " + ticker_name + " to estimate mu and sigma.");
     }
 
-    std::string line;
-    std::string date;
-    std::vector<double> logReturns;
-    std::vector<double> closePrices;
+    const double mu = log_returns.mean();
+    const double sigma = std::sqrt((log_returns.array() - mu).square().sum() / static_cast<double>(log_returns.size() - 1));
 
-    // Read the header and ignore it
-    std::getline(file, line);
+    return Equity(ticker_name, share_no, static_cast<std::float_t>(last_price), static_cast<std::float_t>(mu),
+        static_cast<std::float_t>(sigma));
+};
 
-    while (getline(file, line))
+// import data for several tickers in one call of the plugin and return the Equities
+// the yfinance code lives in a plugin loaded only here: the executable doesn't link Python
+std::vector<Equity> importTickers(const std::vector<std::string>& ticker_list, const std::vector<std::uint16_t>& share_no_list, const std::string& plugin_path)
+{
+    if (ticker_list.size() != share_no_list.size())
     {
-        std::stringstream ss(line);
-        std::string value;
-        double log_return;
-        double close_price;
-
-        // Read Date (ignore)
-        std::getline(ss, date, ',');
+        throw std::invalid_argument("importTickers: one number of shares per ticker is needed.");
+    }
 
-        // Read Close
-        std::getline(ss, value, ',');
-        close_price = stod(value);
+    const ImportPlugin plugin(plugin_path);
+    const TickerBatch batch = plugin.fetchTickers(ticker_list);
 
-        // Read Returns (ignore)
-        std::getline(ss, value, ',');
+    std::vector<Equity> equities;
+    equities.reserve(batch.size());
+    for (std::size_t i = 0; i < batch.size(); ++i)
+    {
+        const auto close_prices = batch.getClosePrices(i);
+        if (close_prices.size() == 0)
+        {
+            throw std::runtime_error("No prices for " + ticker_list[i] + " from " + plugin_path);
+        }
+        equities.push_back(calibrateEquity(ticker_list[i], share_no_list[i], batch.getLogReturns(i), close_prices(close_prices.size() - 1)));
+    }
+    return equities;
+};
 
-        // Read Log Returns
-        std::getline(ss, value, ',');
-        log_return = stod(value);
+// import data for one ticker and return an Equity
+Equity importOneTicker(const std::string& ticker_name, const std::uint16_t& share_no, const std::string& plugin_path)
+{
+    return importTickers({ ticker_name }, { share_no }, plugin_path).front();
+};
 
-        closePrices.push_back(close_price);
-        logReturns.push_back(log_return);
+// same estimates as the import plugin from the csv file
+Equity calibrateFromCsv(const std::string& ticker_name, const std::uint16_t& share_no, const std::string& path, const std::size_t window)
+{
+    const auto [logReturns, closePrices] = readLogReturns(path, window);
+    if (closePrices.empty())
+    {
+        throw std::runtime_error("No prices in " + path);
     }
 
-    file.close();
-    return {logReturns, closePrices};
-}
-
+    const Eigen::Map<const Eigen::VectorXd> returns(logReturns.data(), static_cast<Eigen::Index>(logReturns.size()));
+    return calibrateEquity(ticker_name, share_no, returns, closePrices.back());
+};
 
-// THIS FUNCTION IS NOT USED ANYMORE
-// import data from yfinance for multiple tickers
-//std::tuple<std::vector<std::float_t>, std::vector<std::vector<double>> > importMultipleTickers(const std::vector<std::string>& ticker_list, const std::vector<std::uint16_t>& share_no_list)
-//std::tuple<std::vector<std::float_t>, std::vector<std::vector<double>>> importMultipleTickers(const std::vector<std::string>& ticker_list, const std::vector<std::uint16_t>& share_no_list)
-std::float_t importMultipleTickers(std::vector<std::string>& ticker_list, const std::vector<std::uint16_t>& share_no_list)
+// Function to read Log Returns and Close Prices from a CSV file
+//std::vector<double> readLogReturns(const std::string& filename)
+// the file is memory-mapped and parsed with std::from_chars (see CsvLoader.h), the vectors are sized from the row count
+// a window is found by scanning backward from the end: the time is proportional to the window, not to the history
+std::pair<std::vector<double>, std::vector<double>> readLogReturns(const std::string& filename, const std::size_t window)
 {
-    // WARNING: using pybind11 to embed python works properly, but
-    // it makes the code non-portable
-    // use CSV files to load data instead
-    py::scoped_interpreter guard{};  // Start Python interpreter
-    py::module_ np = py::module_::import("numpy");
-    py::module_ yf = py::module_::import("yfinance");
-    py::module_ sci = py::module_::import("scipy");
-
-    const py::dict GLOBALS;  // Create a namespace to store the python variables
+    try
+    {
+        const MappedFile file(filename);
+        const CsvTail tail = window > 0 ? findCsvTail(file, window) : CsvTail{ 0, countCsvRows(file) };
 
-    // Convert C++ vector to Python list
-    GLOBALS["tickers"] = py::cast(ticker_list);
+        std::vector<double> logReturns(tail.rows);
+        std::vector<double> closePrices(tail.rows);
+        parseReturnCsv(file, logReturns, closePrices, {}, tail.offset);
 
-    return 100.5f;  // std::make_tuple(LAST_PRICES, CHOLESKY_MATRIX);   // {LAST_PRICES, CHOLESKY_MATRIX};
+        return {std::move(logReturns), std::move(closePrices)};
+    } catch (const std::runtime_error& error) {
+        std::cerr << "Failed to read file: " << error.what() << '\n';
+        return {};
+    }
+}
 
-}
\ No newline at end of file
@@ -1,19 +1,37 @@
 #pragma once
+#include <span>
 #include <vector>
+#include <Eigen/Dense>
 #include "Equity.h"
+#include "PathMatrix.h"
 
 // worst case out of the last simulation: it returns a scalar
 std::float_t percentile(const std::vector<std::float_t>& data, std::float_t percent);
 
+// same as percentile() without copying: the data is reordered in place
+std::float_t percentileInPlace(std::span<std::float_t> data, std::float_t percent);
+
 // worst case out of the last simulation: it returns an array, usually used to plot
 std::vector<std::float_t> percentile_2D(const std::vector<std::vector<std::float_t>>& data, std::float_t percent);
 
-// import data from yfinance for one ticker
-Equity importOneTicker(const std::string& ticker_name, const std::uint16_t& share_no);
+// same as percentile_2D() on a path matrix: every row is reordered in place
+std::vector<std::float_t> percentile_2D(PathMatrix& data, std::float_t percent);
+
+// Equity with the mean and the sample standard deviation of the daily log returns (mu and sigma) and the last price
+Equity calibrateEquity(const std::string& ticker_name, const std::uint16_t& share_no, const Eigen::Ref<const Eigen::VectorXd>& log_returns, double last_price);
+
+// import data from yfinance (or the provider module of the plugin) for several tickers in one call of the import
+// plugin (see ImportPlugin.h): the interpreter and the provider stay loaded for the next calls
+std::vector<Equity> importTickers(const std::vector<std::string>& ticker_list, const std::vector<std::uint16_t>& share_no_list, const std::string& plugin_path);
+
+// import data from yfinance for one ticker with the import plugin
+Equity importOneTicker(const std::string& ticker_name, const std::uint16_t& share_no, const std::string& plugin_path);
+
+// estimate mu and sigma of one ticker from its csv file, without Python: with a window > 0 only the last rows are used
+Equity calibrateFromCsv(const std::string& ticker_name, const std::uint16_t& share_no, const std::string& path, std::size_t window = 0);
 
 //std::vector<double> readLogReturns(const std::string& filename);
-std::pair<std::vector<double>, std::vector<double>> readLogReturns(const std::string& filename);
+// log returns and close prices of a csv file: with a window > 0 only the last `window` rows are read (from the end
+// of the file), 0 reads the whole history
+std::pair<std::vector<double>, std::vector<double>> readLogReturns(const std::string& filename, std::size_t window = 0);
 
-// THIS FUNCTION IS NOT USED ANYMORE
-// import data from yfinance for multiple tickers
-std::float_t importMultipleTickers(const std::vector<std::string>& ticker_list, const std::vector<std::uint16_t>& share_no_list);
\ No newline at end of file
@@ -1,34 +1,64 @@
-#include <pybind11/embed.h>  // Pybind11 for embedding Python
-#include <pybind11/stl.h>  // Required for automatic conversion of STL containers
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 #include <cmath>
 #include <iomanip>
 #include <random>
-#include <cmath>
 #include <cstdlib> // Required for exit()
-#include </usr/local/Cellar/eigen/3.4.0_1/include/eigen3/Eigen/Dense>
-#include </usr/local/Cellar/eigen/3.4.0_1/include/eigen3/unsupported/Eigen/CXX11/Tensor>
+#include <Eigen/Dense>
 #include "Equity.h"
 #include "functions.h"
 #include "MultiEquityPortfolio.h"
 #include "Random.h"
 #include "Portfolio.h"
+#include "CovarianceCache.h"
+#include "CsvLoader.h"
+#include "MarketDataStore.h"
+#include "CovarianceModel.h"
+#include "MonteCarloEngine.h"
+#include "RiskMeasures.h"
 
 namespace Global
 {
     // number of montecarlo simulations to run: a low number of simulations (<= 10) is not advisable
-    constexpr std::int16_t SIMULATIONS { 1000 };
+    constexpr std::int64_t SIMULATIONS { 1000 };
     // days to forecast
-    constexpr std::int16_t TRADING_DAYS { 5 };
+    constexpr std::int32_t TRADING_DAYS { 5 };
+    // memory the simulations may use: larger runs are split in chunks and folded into the VaR/ES as they go
+    constexpr std::size_t MEMORY_BUDGET { std::size_t{ 256 } << 20 };
     // Ito's lemma: used in the Geometric Brownian Motion and the Stochastic Calculus
     constexpr std::float_t ITO { 0.5 };
     // SHARES is the number of shares, S0 is the last price: error if constexpr is used
     // level of confidence
     constexpr std::float_t CONF_LEVEL { 5.0 };
+    // percentile bands of the fan chart
+    const std::vector<std::float_t> FAN_CHART_PERCENTS = {1.0f, 5.0f, 50.0f, 95.0f, 99.0f};
+    // csv file of the fan chart of a single ticker (one line per day), relative paths are in the working directory:
+    // an empty string disables it
+    const std::string FAN_CHART_PATH = "fan_chart.csv";
+    // relative accuracy of the fan chart when the paths don't fit in MEMORY_BUDGET (one quantile sketch per day):
+    // finer than the daily moves of the price
+    constexpr double FAN_CHART_ACCURACY { 0.0001 };
+    // confidence levels of VaR and ES in the multi-ticker portfolio
+    const std::vector<double> CONF_LEVELS = {0.95, 0.99};
     // daily time step: if weekly then 1/52
     constexpr std::float_t DT { 1.0f / 252.0f };
+    // factors of the covariance model: 0 uses the full covariance matrix and its Cholesky decomposition,
+    // K > 0 a factor model with the first K principal components (for portfolios with thousands of tickers)
+    constexpr std::int32_t FACTOR_COUNT { 0 };
+    // trading days in a year: the covariance matrix is annualized (same factor as getReturnCovarianceMatrix())
+    constexpr double ANNUALIZATION { 252.0 };
+    // covariance files kept in the cache directory (N^2-sized): the least recently used ones are removed
+    constexpr std::size_t CACHE_FILES { 4 };
+    // seed of the random numbers: 0 draws a new seed on every run, any other value reproduces the same results
+    constexpr std::uint64_t SEED { 0 };
+    // antithetic variates: every simulation is paired with the mirrored one (normals -z), the mean-loss variance ratio is printed
+    constexpr bool ANTITHETIC { false };
 
     // tickers and number of shares can be inputted at run-time?
     // std::string is used because std::string_view can cause dangling references in the Portfolio
@@ -36,18 +66,43 @@ namespace Global
     const std::vector<std::uint16_t> TICKERS_SHARES = {10, 15, 20};
 
     const std::vector<std::string> PATH_LIST = {"AAPL.csv", "CIM.csv", "CVX.csv"};
+    // import plugin of the single-ticker data (built with MCVAR_WITH_PYTHON, e.g. "./libmcvar_yfinance.so"):
+    // empty estimates mu and sigma from the csv file of the ticker, without Python
+    const std::string IMPORT_PLUGIN = "";
+    // dates missing from some csv files: Drop keeps the common dates, ForwardFill keeps the last price,
+    // Pairwise estimates each covariance on the dates both tickers have
+    constexpr MissingDates MISSING_DATES { MissingDates::Drop };
+    // days of history used for the calibration, read from the end of the csv files: 0 uses the whole history
+    constexpr std::size_t LOOKBACK_DAYS { 0 };
+
+    // files written by the multi-ticker run, relative paths are in the working directory: an empty string disables them
+    // binary store of the csv files: memory-mapped at start-up, rebuilt when a csv file is newer
+    // (empty: the csv files are loaded on every run)
+    const std::string MARKET_DATA_PATH = "portfolio.mcvar";
+    // directory of the covariance cache (covariance_<fingerprint>.cache files, empty: no cache)
+    const std::string CACHE_DIRECTORY = ".";
 
 }
 
 int main()
 {
+    // the simulations are split across all the cores
+    ThreadPool pool;
 
     if (Global::TICKERS.size() == 1)
     {
         std::cout << "Loading one ticker..." << '\n';
 
         Portfolio dumbPortfolio; // stack allocation
-        dumbPortfolio.addEquity(importOneTicker(Global::TICKERS[0], Global::TICKERS_SHARES[0]));
+        try
+        {
+            dumbPortfolio.addEquity(Global::IMPORT_PLUGIN.empty()
+                ? calibrateFromCsv(Global::TICKERS[0], Global::TICKERS_SHARES[0], Global::PATH_LIST[0], Global::LOOKBACK_DAYS)
+                : importOneTicker(Global::TICKERS[0], Global::TICKERS_SHARES[0], Global::IMPORT_PLUGIN));
+        } catch (const std::runtime_error& error) {
+            std::cerr << "Error: " << error.what() << '\n';
+            return 1;
+        }
 
         // print all the equities in the portfolio
         for (const auto& equity : dumbPortfolio.getEquities())
@@ -70,71 +125,75 @@ int main()
             }
 
             // input trading days and validate the data type: >= 1 and <= 252)
-            std::int16_t TRADING_DAYS{};
+            std::int32_t TRADING_DAYS{};
             std::cout << "How many trading days (must be >= 1 and <= 252): " << '\n';
-            while (!(std::cin >> TRADING_DAYS) || TRADING_DAYS > 252)
+            while (!(std::cin >> TRADING_DAYS) || TRADING_DAYS < 1 || TRADING_DAYS > 252)
             {
                 std::cin.clear();  // Clear error flag
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');  // Discard invalid input
                 std::cout << "Invalid input. Please enter an integer between 1 and 252: ";
             }
 
-            // number of steps
-            const int16_t STEPS = TRADING_DAYS;
             // variables to use for random prices
             const std::float_t DRIFT = (mu - Global::ITO * std::pow(sigma, 2.0f)) * Global::DT;
             const std::float_t DIFFUSION_COEFF = sigma * std::sqrt(Global::DT);
 
-            // initialize an empty 2-D vector
-            std::vector<std::vector<std::float_t>> simulated_prices;
-
-            if (STEPS == 1)
+            SimulationConfig config;
+            config.simulations = Global::SIMULATIONS;
+            config.trading_days = TRADING_DAYS;
+            config.dt = Global::DT;
+            config.seed = Global::SEED;
+            config.memory_budget = Global::MEMORY_BUDGET;
+            config.antithetic = Global::ANTITHETIC;
+
+            // matrix size is TRADING_DAYS + 1 x SIMULATIONS (rows x columns): row [0] is the portfolio value
+            const SingleEquityEngine engine(dumbPortfolio.getPortfolioValue(), DRIFT, DIFFUSION_COEFF);
+            std::optional<PathMatrix> simulated_prices;
+            try
             {
-                // matrix size is STEPS + 1 x SIMULATIONS (rows x columns)
-                // assign the portfolio value to the first row [0]: it will be the starting point
-                simulated_prices = std::vector(STEPS + 1, std::vector(Global::SIMULATIONS, 0.0f));
-                for (int i = 0; i < Global::SIMULATIONS; ++i)
-                {
-                    simulated_prices[0][i] = dumbPortfolio.getPortfolioValue();
-                }
-
-                for (int i = 0; i < Global::SIMULATIONS; ++i)
-                {
-                    // row [1] will have the prices randomly generated below
-                    const std::float_t rand = Random::getNormalRandom();
-                    simulated_prices[1][i] = simulated_prices[0][i] * std::exp(DRIFT + DIFFUSION_COEFF * rand);
-                }
+                simulated_prices.emplace(engine.simulatePaths(config, pool));
+            } catch (const std::length_error&) {
+                // the path matrix doesn't fit in the memory budget: the streaming fan chart below
             }
-            else if (STEPS > 1 && STEPS <= 252)
-            {
-                // matrix size is STEPS x SIMULATIONS (rows x columns)
-                // assign the portfolio value to the first row [0]: it will be the starting point
-                simulated_prices = std::vector(STEPS, std::vector(Global::SIMULATIONS, 0.0f));
-                for (int i = 0; i < Global::SIMULATIONS; ++i)
-                {
-                    simulated_prices[0][i] = dumbPortfolio.getPortfolioValue();
-                }
 
-                // Generate normally distributed random prices for rows >= [1]
-                for (int t = 1; t < STEPS; ++t)
-                {
-                    for (int i = 0; i < Global::SIMULATIONS; ++i)
-                    {
-                        const std::float_t rand = Random::getNormalRandom();
-                        simulated_prices[t][i] = simulated_prices[t - 1][i] * std::exp(DRIFT + DIFFUSION_COEFF * rand);
-                    }
-                }
+        std::float_t percentile_95 {};
+        FanChart fan_chart;
+        if (simulated_prices)
+        {
+            // the pairs of the last row are compared before the percentile reorders it
+            if (config.antithetic)
+            {
+                AntitheticStatistics antithetic;
+                antithetic.add(std::span<const std::float_t>(simulated_prices->lastRow()));
+                std::cout << "Antithetic variates: mean-loss variance ratio " << std::setprecision(3) << antithetic.getMeanLossVarianceRatio()
+                    << std::setprecision(6) << '\n';
             }
 
-        // last row of the matrix
-        std::vector<std::float_t> last_simulation_prices = simulated_prices.back();
-
-        // Calculate the percentile
-        const std::float_t percentile_95 = percentile(last_simulation_prices, Global::CONF_LEVEL);
+            // Calculate the percentile of the last row of the matrix (reordered in place, no copy)
+            percentile_95 = percentileInPlace(simulated_prices->lastRow(), Global::CONF_LEVEL);
+
+            // the percentile bands of the portfolio value at every day, to plot (the rows are reordered in place)
+            fan_chart = computeFanChart(*simulated_prices, Global::FAN_CHART_PERCENTS, pool);
+        } else {
+            // same paths, one quantile sketch per day instead of the matrix: the percentiles are within FAN_CHART_ACCURACY
+            // and not interpolated
+            std::cout << "The paths don't fit in the memory budget: the percentiles are estimated while they are simulated" << '\n';
+            const StreamingFanChart streaming_fan_chart = engine.simulateFanChart(config, pool, Global::FAN_CHART_ACCURACY);
+            percentile_95 = streaming_fan_chart.getFanChart({ Global::CONF_LEVEL }).bands.front().back();
+            fan_chart = streaming_fan_chart.getFanChart(Global::FAN_CHART_PERCENTS);
+        }
         std::cout << "Lowest value of the portfolio (95% confidence level): " << percentile_95 << std::endl;
 
-        // this can be useful to plot
-        std::vector<std::float_t> percentile_95_array = percentile_2D(simulated_prices, Global::CONF_LEVEL);
+        if (!Global::FAN_CHART_PATH.empty())
+        {
+            try
+            {
+                writeFanChart(fan_chart, Global::FAN_CHART_PATH);
+                std::cout << "Fan chart of the portfolio value (percentiles by day) written to " << Global::FAN_CHART_PATH << '\n';
+            } catch (const std::runtime_error& error) {
+                std::cerr << "Error: " << error.what() << '\n';
+            }
+        }
 
         // calculate the VaR and the VaR %
         const std::float_t VaR_95 { percentile_95 - dumbPortfolio.getPortfolioValue() };
@@ -150,242 +209,139 @@ int main()
     {
         std::cout << "Loading multiple tickers..." << "\n\n";
 
-        // Extract the number of days only for the first ticker: it will be used to check the others'
-        auto [apple_returns, apple_prices] = readLogReturns(Global::PATH_LIST[0]);
-        size_t n_days = apple_returns.size(); // this is the number of days in the csv file
-
-
-        // The matrix will store the log returns, the vector the last known prices
-        Eigen::MatrixXd logReturnsMatrix(n_days, Global::TICKERS.size());
-        Eigen::VectorXd last_prices(Global::TICKERS.size());
-
-        // In the Eigen matrix logReturnsMatrix each column is the stock log returns, the rows are n_days
-        for (int col = 0; col < Global::TICKERS.size(); col++)
+        // The returns are memory-mapped from the binary store (built from the csv files in parallel and aligned by date
+        // when it's missing or out of date): each column is the stock log returns, the rows are the days. The vector stores the last known prices
+        // without a store path the csv files are loaded and aligned in memory
+        MultiEquityPortfolio newPortfolio;
+        try
         {
-            auto [returns, prices] = readLogReturns(Global::PATH_LIST[col]);
-
-            // Ensure that vectors have all the same size
-            if (returns.size() != n_days)
-            {
-                std::cerr << "Error: CSV files have different numbers of days!" << '\n';
-                return 1;
-            }
-
-            for (int row = 0; row < n_days; row++)
+            if (!Global::MARKET_DATA_PATH.empty())
             {
-                logReturnsMatrix(row, col) = returns[row];
+                // the portfolio reads the returns from the mapped file without copying them
+                newPortfolio = MultiEquityPortfolio(MarketDataStore::openOrBuild(Global::MARKET_DATA_PATH, Global::TICKERS, Global::PATH_LIST, pool,
+                    Global::MISSING_DATES, Global::LOOKBACK_DAYS), Global::TICKERS_SHARES);
+            } else {
+                ReturnData data = loadReturnData(Global::PATH_LIST, pool, Global::MISSING_DATES, Global::LOOKBACK_DAYS);
+                newPortfolio = MultiEquityPortfolio(std::move(data.log_returns), std::move(data.last_prices), Global::TICKERS, Global::TICKERS_SHARES);
             }
-
-            double last = prices.back();
-            last_prices(col) = last;
-        }
-
-        MultiEquityPortfolio newPortfolio(logReturnsMatrix, last_prices, Global::TICKERS, Global::TICKERS_SHARES);
-
-        // a vector with the mean values and a covariance matrix
-        const Eigen::VectorXd meanVector = newPortfolio.getMean();
-        const Eigen::MatrixXd annualizedCovarianceMatrix = newPortfolio.getReturnCovarianceMatrix();
-
-        //std::cout << "Mean of each stock:\n" << meanVector << '\n';
-        //std::cout << "Covariance Matrix:\n" << annualizedCovarianceMatrix << "\n\n";
-
-        // Compute Cholesky decomposition
-        Eigen::LLT<Eigen::MatrixXd> llt(annualizedCovarianceMatrix);
-        if (llt.info() == Eigen::NumericalIssue)
-        {
-            std::cerr << "Error: Covariance matrix is not positive definite!" << std::endl;
+        } catch (const std::runtime_error& error) {
+            std::cerr << "Error: " << error.what() << '\n';
             return 1;
         }
+        const Eigen::VectorXd last_prices = newPortfolio.getLastPriceVector();
 
-        // Lower triangular matrix of the Cholesky decomposition matrixx
-        Eigen::MatrixXd L = llt.matrixL();
-
-        // Create a random number generator with normal distribution
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::normal_distribution<> d(0.0, 1.0);
-
-        // Create a 3D tensor (TRADING_DAYS, num_tickers, SIMULATIONS) to hold the random values
-        Eigen::Tensor<double, 3> rand_normals(Global::TRADING_DAYS, Global::TICKERS.size(), Global::SIMULATIONS);
-
-        // This code is used to avoid that random values are not zero
-        for (int i = 0; i < Global::TRADING_DAYS; i++) {
-            for (int j = 0; j < Global::TICKERS.size(); j++) {
-                for (int k = 0; k < Global::SIMULATIONS; k++) {
-                    double value;
-                    do {
-                        value = d(gen);  // Generate random value
-                    } while (value == 0.0); // Ensure it's not zero
-                    rand_normals(i, j, k) = value;
-                }
-            }
-        }
-
-        // Example: Print a specific value (e.g., row 0, ticker 1, simulation 0)
-        //std::cout << "First random value (row 0, ticker 1, sim 0): " << rand_normals(0, 1, 10) << std::endl;
-
-        // Correlated shocks tensor (TRADING_DAYS, TICKERS.size(), SIMULATIONS)
-        // shocks in simulations are unexpected changes in the asset prices
-        Eigen::Tensor<double, 3> correlated_shocks(Global::TRADING_DAYS, Global::TICKERS.size(), Global::SIMULATIONS);
-
-        // Define 2 empty matrices
-        Eigen::MatrixXd rand_matrix;
-        Eigen::MatrixXd result_matrix;
-
-        //Perform matrix multiplication: correlated_shocks = L * rand_normals
-        for (int t = 0; t < Global::TRADING_DAYS; t++)
+        // a vector with the mean values and the covariance model that correlates the random shocks of the simulations
+        Eigen::VectorXd meanVector;
+        std::shared_ptr<const CovarianceModel> covariance_model;
+        if (Global::FACTOR_COUNT > 0)
         {
-            rand_matrix.resize(Global::TICKERS.size(), Global::SIMULATIONS);
-            result_matrix.resize(Global::TICKERS.size(), Global::SIMULATIONS);
+            // low-rank factor model: no N x N matrix and no Cholesky decomposition, O(N * K) per simulation step
+            meanVector = newPortfolio.getMean();
+            try
+            {
+                covariance_model = std::make_shared<FactorModel>(FactorModel::fromReturns(newPortfolio.getReturnMatrix(), Global::FACTOR_COUNT, Global::ANNUALIZATION));
+            } catch (const std::invalid_argument& error) {
+                std::cerr << "Error: " << error.what() << std::endl;
+                return 1;
+            }
+        } else {
+            // mean, covariance and Cholesky factor are reused from the cache when the returns haven't changed
+            const bool use_cache = !Global::CACHE_DIRECTORY.empty();
+            const CovarianceCache cache(Global::CACHE_DIRECTORY, Global::CACHE_FILES);
+            const std::uint64_t fingerprint = use_cache ? CovarianceCache::fingerprint(newPortfolio.getReturnMatrix(), Global::ANNUALIZATION) : 0;
+            std::optional<CovarianceEstimate> estimate;
+            if (use_cache)
+            {
+                estimate = cache.load(fingerprint, newPortfolio.getReturnMatrix().cols());
+            }
 
-            // Extract (TICKERS.size() x Global::SIMULATIONS) slice from rand_normals
-            for (int j = 0; j < Global::TICKERS.size(); j++)
+            if (!estimate)
             {
-                for (int s = 0; s < Global::SIMULATIONS; s++)
+                // mean and covariance in one pass over the returns, in parallel
+                ReturnStatistics statistics = newPortfolio.getReturnStatistics(pool);
+                estimate.emplace();
+                estimate->mean = std::move(statistics.mean);
+                estimate->covariance = std::move(statistics.covariance);
+
+                //std::cout << "Mean of each stock:\n" << estimate->mean << '\n';
+                //std::cout << "Covariance Matrix:\n" << estimate->covariance << "\n\n";
+
+                // Compute Cholesky decomposition
+                Eigen::LLT<Eigen::MatrixXd> llt(estimate->covariance);
+                if (llt.info() == Eigen::NumericalIssue)
                 {
-                    rand_matrix(j, s) = rand_normals(t, j, s);
+                    std::cerr << "Error: Covariance matrix is not positive definite!" << std::endl;
+                    return 1;
                 }
-            }
 
-            // Perform matrix multiplication: result_matrix = L * rand_matrix
-            result_matrix = L * rand_matrix;
+                // Lower triangular matrix of the Cholesky decomposition matrixx
+                estimate->cholesky_lower = llt.matrixL();
 
-            // Store the result back in the correlated_shocks tensor
-            for (int i = 0; i < Global::TICKERS.size(); i++)
-            {
-                for (int s = 0; s < Global::SIMULATIONS; s++)
+                // a cache that can't be written only costs the next run the same computation
+                try
                 {
-                    correlated_shocks(t, i, s) = result_matrix(i, s);
+                    if (use_cache)
+                    {
+                        cache.store(fingerprint, *estimate);
+                    }
+                } catch (const std::runtime_error& error) {
+                    std::cerr << "Warning: " << error.what() << std::endl;
                 }
+            } else {
+                std::cout << "Covariance loaded from the cache" << "\n\n";
             }
-        }
-
-        // Example: Print first correlated shock value
-        //std::cout << "First correlated shock 1: " << correlated_shocks(0, 0, 0) << std::endl;
-        //std::cout << "First correlated shock 2: " << correlated_shocks(20, 2, 999) << std::endl;
-        //std::cout << correlated_shocks.dimensions() << '\n';
-
-        // SO FAR rand_normals AND correlated_shocks HAVE NO ZERO VALUES AND BOTH SHAPE [TRADING_DAYS, TICKERS, SIMULATIONS]
-
-        // Simulate price paths using GBM
-        // Initialize a 3D tensor and set the prices to zero (22 x 3 x 1000)
-        Eigen::Tensor<double, 3> simulated_prices(Global::TRADING_DAYS + 1, Global::TICKERS.size(), Global::SIMULATIONS);
-        simulated_prices.setZero();
-
 
-        // Assign the last known price for each equity to simulated_prices[0, :, :]
-        for (int j = 0; j < Global::TICKERS.size(); ++j)
-        {
-            for (int s = 0; s < Global::SIMULATIONS; ++s) {
-                simulated_prices(0, j, s) = last_prices(j);
-            }
+            meanVector = std::move(estimate->mean);
+            covariance_model = std::make_shared<CholeskyModel>(std::move(estimate->cholesky_lower));
         }
 
         // These constant variables will be used to calculate the simulated prices
-        const Eigen::VectorXd covDiagonal = annualizedCovarianceMatrix.diagonal();
+        const Eigen::VectorXd covDiagonal = covariance_model->getVariances();
         const Eigen::VectorXd drift = (meanVector.array() - Global::ITO * covDiagonal.array()) * Global::DT;
-        double sqrtDt = sqrt(Global::DT);
 
-        for (int t = 1; t < Global::TRADING_DAYS + 1; t++)
-        {
-             // Iterate over assets and simulations
-             for (int j = 0; j < Global::TICKERS.size(); ++j) {
-                 for (int s = 0; s < Global::SIMULATIONS; ++s) {
-                     // Compute diffusion: correlated_shocks[t - 1, j, s] * sqrt(dt)
-                     double diffusion = correlated_shocks(t - 1, j, s) * sqrtDt;
-
-                     // Compute price update using GBM: S_t = S_t-1 * exp(drift + diffusion)
-                     simulated_prices(t, j, s) = simulated_prices(t - 1, j, s) * std::exp(drift(j) + diffusion);
-                 }
-             }
-        }
+        // The engine simulates the GBM paths block by block: only the terminal loss of each simulation is stored
+        const MultiEquityEngine engine(covariance_model, drift, last_prices, Global::TICKERS_SHARES);
 
-        // Print a sample value for verification: index1 is the trading days, index2 is the equity, index3 is the simulation
-        // std::cout << "Simulated price at T=21, Asset=0, Simulation=0: " << simulated_prices(21, 1, 0) << std::endl;
+        SimulationConfig config;
+        config.simulations = Global::SIMULATIONS;
+        config.trading_days = Global::TRADING_DAYS;
+        config.dt = Global::DT;
+        config.seed = Global::SEED;
+        config.memory_budget = Global::MEMORY_BUDGET;
+        config.antithetic = Global::ANTITHETIC;
 
         // This is value of the portfolio before the simulations
-        double portfolio_initial_value {last_prices[0] * Global::TICKERS_SHARES[0]
-            + last_prices[1] * Global::TICKERS_SHARES[1] + last_prices[2] * Global::TICKERS_SHARES[2]};
+        const double portfolio_initial_value { engine.getInitialValue() };
 
         std::cout << '\n' << "Portfolio value before the simulations: $" << portfolio_initial_value << "\n\n";
 
-        // Extract the last simulation
-        Eigen::MatrixXd last_simulation(Global::TICKERS.size(), Global::SIMULATIONS);
-        for (int i = 0; i < Global::TICKERS.size(); i++)
+        // Compute the profit/loss distribution chunk by chunk: only the worst 5% of the losses are kept, or a quantile
+        // sketch when they don't fit in the memory budget
+        // VaR and Expected Shortfall (the average loss beyond the VaR) for both confidence levels
+        const RiskReport risk_report = engine.simulateRisk(config, pool, Global::CONF_LEVELS);
+
+        if (!risk_report.plan.exact_tail)
         {
-            for (int j = 0; j < Global::SIMULATIONS; ++j)
-            {
-                last_simulation(i, j) = simulated_prices(Global::TRADING_DAYS, i, j);
-            }
+            std::cout << "The worst losses don't fit in the memory budget: VaR and ES are estimated within 0.1%" << '\n';
         }
-
-        // Convert the vector TICKERS_SHARES into an Eigen vector of doubles
-        Eigen::VectorXd number_of_shares(3);
-        for (size_t i = 0; i < Global::TICKERS_SHARES.size(); i++)
+        if (config.antithetic)
         {
-            number_of_shares(i) = static_cast<double>(Global::TICKERS_SHARES[i]);
+            // the mean loss has the same standard error as mean_loss_variance_ratio times more independent simulations
+            std::cout << "Antithetic variates: mean-loss variance ratio " << std::setprecision(3) << risk_report.mean_loss_variance_ratio
+                << std::setprecision(6) << '\n';
         }
 
-        Eigen::MatrixXd last_simulation_transposed = last_simulation.transpose(); // (1000x3)
-        // Perform a multiplication matrix-vector: (1000x3) * (3x1) = (1000x1)
-        Eigen::VectorXd final_values = last_simulation_transposed * number_of_shares;
-
-
-        // Print part of the result
-        // std::cout << "Result (first 5 elements):\n" << final_values.head(5) << "\n...\n";
-
-        // Compute profit/loss distribution
-        Eigen::VectorXd losses = (Eigen::VectorXd::Constant(final_values.size(), portfolio_initial_value) - final_values).matrix();
-
-
-        // Convert Eigen::VectorXd to std::vector for sorting
-        std::vector<double> values(losses.data(), losses.data() + losses.size());
-
-        // Sort the values (ascending order)
-        std::sort(values.begin(), values.end());
-
-        // Compute the index for the 5th percentile (VaR_95)
-        auto index95 = static_cast<size_t>(std::round(0.05 * (values.size() - 1)));  // 5th percentile index
-
-        // Extract the 5th percentile value
-        double VaR_95 = values[index95];
-        double VaR_95_perc {VaR_95 / portfolio_initial_value * 100.0f};
-
-        // Calculate the Expected Shortfall beyond the confidence level 95%
-        double es_sum_95 { 0.0 };
-        double indexes_es_95 { 0.0 };
-        for (size_t i = 0; i < (index95 - 1); i++) {
-            indexes_es_95 += 1;
-            es_sum_95 += values[i];  // sum values beyond index95
-        }
-        double es_mean_95 = es_sum_95 / indexes_es_95;
-
-        std::cout << "Value at Risk after " << Global::TRADING_DAYS <<  " days (confidence level 95%): " << VaR_95 << '\n';
-        std::cout << "Value at Risk % : " << std::setprecision(3) << VaR_95_perc << '\n';
-        std::cout << std::setprecision(6) << std::defaultfloat; // this resets the precision for the following value
-        std::cout << "Expected Shortfall (ES) beyond 95% : " << es_mean_95 << std::endl;
-
-        // Compute the index for the 1st percentile
-        auto index99 = static_cast<size_t>(std::round(0.01 * (values.size() - 1)));  // 1st percentile index
-
-        // Extract the 1st percentile value
-        double VaR_99 = values[index99];
-        double VaR_99_perc {VaR_99 / portfolio_initial_value * 100.0f};
-
-        // Calculate the Expected Shortfall beyond the confidence level 99%
-        double es_sum_99 { 0.0 };
-        double indexes_es_99 { 0.0 };
-        for (size_t i = 0; i < (index99 - 1); i++) {
-            indexes_es_99 += 1;
-            es_sum_99 += values[i];  // sum values beyond index95
+        for (const auto& measure : risk_report.measures)
+        {
+            const double confidence_perc { measure.confidence * 100.0 };
+            const double VaR_perc { measure.value_at_risk / portfolio_initial_value * 100.0 };
+
+            std::cout << "\n=======================================\n" << std::endl;
+            std::cout << "Value at Risk after " << Global::TRADING_DAYS <<  " days (confidence level " << confidence_perc << "%): " << measure.value_at_risk << '\n';
+            std::cout << "Value at Risk % : " << std::setprecision(3) << VaR_perc << '\n';
+            std::cout << std::setprecision(6) << std::defaultfloat; // this resets the precision for the following value
+            std::cout << "Expected Shortfall (ES) beyond " << confidence_perc << "% : " << measure.expected_shortfall << std::endl;
         }
-        double es_mean_99 = es_sum_99 / indexes_es_99;
-
-        std::cout << "\n=======================================\n" << std::endl;
-        std::cout << "Value at Risk after " << Global::TRADING_DAYS <<  " days (confidence level 99%): " << VaR_99 << std::endl;
-        std::cout << "Value at Risk % : " << std::setprecision(3) << VaR_99_perc << std::endl;
-        std::cout << std::setprecision(6) << std::defaultfloat; // this resets the precision for the following value
-        std::cout << "Expected Shortfall (ES) beyond 99% : " << es_mean_99 << std::endl;
     }
 
     return 0;
@@ -0,0 +1,138 @@
+#include <filesystem>
+#include <string>
+#include <Eigen/Dense>
+#include "CovarianceCache.h"
+#include "TestCheck.h"
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    // empty directory of one test case
+    std::string makeDirectory(const std::string& name)
+    {
+        const fs::path directory = fs::path("CovarianceCacheTest_data") / name;
+        fs::remove_all(directory);
+        fs::create_directories(directory);
+        return directory.string();
+    }
+
+    Eigen::MatrixXd makeReturns(const Eigen::Index rows, const Eigen::Index cols)
+    {
+        Eigen::MatrixXd returns(rows, cols);
+        for (Eigen::Index j = 0; j < cols; ++j)
+        {
+            for (Eigen::Index i = 0; i < rows; ++i)
+            {
+                returns(i, j) = 0.001 * static_cast<double>((i * 7 + j * 13) % 17) - 0.008;
+            }
+        }
+        return returns;
+    }
+
+    CovarianceEstimate makeEstimate(const Eigen::Index n)
+    {
+        CovarianceEstimate estimate;
+        estimate.mean = Eigen::VectorXd::LinSpaced(n, 0.01, 0.02);
+        estimate.covariance = Eigen::MatrixXd::Identity(n, n) * 0.04;
+        estimate.cholesky_lower = Eigen::MatrixXd::Identity(n, n) * 0.2;
+        return estimate;
+    }
+
+    std::size_t countCacheFiles(const std::string& directory)
+    {
+        std::size_t count = 0;
+        for (const auto& entry : fs::directory_iterator(directory))
+        {
+            count += entry.path().extension() == ".cache" ? 1 : 0;
+        }
+        return count;
+    }
+
+    void fingerprintSeesSignAndExponentChanges()
+    {
+        const Eigen::MatrixXd returns = makeReturns(50, 3);
+        const std::uint64_t reference = CovarianceCache::fingerprint(returns, 252.0);
+        CHECK(CovarianceCache::fingerprint(returns, 252.0) == reference);
+
+        // negating two values used to cancel out in the word-wise FNV hash
+        Eigen::MatrixXd negated = returns;
+        negated(3, 0) = -negated(3, 0);
+        negated(10, 2) = -negated(10, 2);
+        CHECK(CovarianceCache::fingerprint(negated, 252.0) != reference);
+
+        // a change of the exponent only
+        Eigen::MatrixXd scaled = returns;
+        scaled(5, 1) *= 2.0;
+        CHECK(CovarianceCache::fingerprint(scaled, 252.0) != reference);
+
+        // same values, other shape and other parameters
+        const Eigen::MatrixXd reshaped = Eigen::Map<const Eigen::MatrixXd>(returns.data(), 75, 2);
+        CHECK(CovarianceCache::fingerprint(reshaped, 252.0) != reference);
+        CHECK(CovarianceCache::fingerprint(returns, 52.0) != reference);
+    }
+
+    void missThenHit()
+    {
+        const CovarianceCache cache(makeDirectory("missThenHit"));
+        const std::uint64_t fingerprint = CovarianceCache::fingerprint(makeReturns(20, 3), 252.0);
+        CHECK(!cache.load(fingerprint, 3));
+
+        const CovarianceEstimate estimate = makeEstimate(3);
+        cache.store(fingerprint, estimate);
+        const std::optional<CovarianceEstimate> loaded = cache.load(fingerprint, 3);
+        CHECK(loaded.has_value());
+        if (loaded)
+        {
+            CHECK(loaded->mean == estimate.mean);
+            CHECK(loaded->covariance == estimate.covariance);
+            CHECK(loaded->cholesky_lower == estimate.cholesky_lower);
+        }
+
+        // another number of assets or another fingerprint is a miss
+        CHECK(!cache.load(fingerprint, 4));
+        CHECK(!cache.load(fingerprint + 1, 3));
+    }
+
+    void truncatedFileIsAMiss()
+    {
+        const std::string directory = makeDirectory("truncatedFileIsAMiss");
+        const CovarianceCache cache(directory);
+        cache.store(42, makeEstimate(3));
+        for (const auto& entry : fs::directory_iterator(directory))
+        {
+            fs::resize_file(entry.path(), fs::file_size(entry.path()) - 8);
+        }
+        CHECK(!cache.load(42, 3));
+    }
+
+    void storeKeepsTheMostRecentlyUsedFiles()
+    {
+        const std::string directory = makeDirectory("storeKeepsTheMostRecentlyUsedFiles");
+        const CovarianceCache cache(directory, 2);
+        const auto now = fs::file_time_type::clock::now();
+
+        cache.store(1, makeEstimate(2));
+        fs::last_write_time(fs::path(directory) / "covariance_0000000000000001.cache", now - std::chrono::hours(3));
+        cache.store(2, makeEstimate(2));
+        fs::last_write_time(fs::path(directory) / "covariance_0000000000000002.cache", now - std::chrono::hours(2));
+
+        // a hit makes 1 the most recently used: storing 3 evicts 2
+        CHECK(cache.load(1, 2).has_value());
+        cache.store(3, makeEstimate(2));
+        CHECK(countCacheFiles(directory) == 2);
+        CHECK(cache.load(1, 2).has_value());
+        CHECK(!cache.load(2, 2).has_value());
+        CHECK(cache.load(3, 2).has_value());
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "fingerprintSeesSignAndExponentChanges", fingerprintSeesSignAndExponentChanges },
+        { "missThenHit", missThenHit },
+        { "truncatedFileIsAMiss", truncatedFileIsAMiss },
+        { "storeKeepsTheMostRecentlyUsedFiles", storeKeepsTheMostRecentlyUsedFiles },
+    });
+}
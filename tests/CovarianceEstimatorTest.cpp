@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "CovarianceEstimator.h"
+#include "MarketDataStore.h"
+#include "MultiEquityPortfolio.h"
+#include "ThreadPool.h"
+#include "TestCheck.h"
+#include "TestData.h"
+
+namespace
+{
+    Eigen::MatrixXd makeReturns(const Eigen::Index days, const Eigen::Index assets)
+    {
+        Eigen::MatrixXd returns(days, assets);
+        for (Eigen::Index j = 0; j < assets; ++j)
+        {
+            for (Eigen::Index i = 0; i < days; ++i)
+            {
+                returns(i, j) = 0.01 * std::sin(0.7 * static_cast<double>(i) + 1.3 * static_cast<double>(j))
+                    + 0.004 * std::cos(0.31 * static_cast<double>(i * (j + 1))) + 0.0005 * static_cast<double>(j);
+            }
+        }
+        return returns;
+    }
+
+    // annualized sample covariance of the rows, recomputed from scratch
+    Eigen::MatrixXd directCovariance(const Eigen::MatrixXd& returns)
+    {
+        const Eigen::MatrixXd centered = returns.rowwise() - returns.colwise().mean();
+        return centered.transpose() * centered * (252.0 / static_cast<double>(returns.rows() - 1));
+    }
+
+    // every day, the rolling estimate is the covariance of the last `window` days, before and after the window is full
+    // and across the periodic rebuilds of the running sums
+    void rollingCovarianceMatchesTheWindow()
+    {
+        constexpr std::size_t window { 20 };
+        const Eigen::MatrixXd returns = makeReturns(75, 6);
+        RollingCovariance rolling(6, window);
+
+        for (Eigen::Index day = 0; day < returns.rows(); ++day)
+        {
+            rolling.add(returns.row(day).transpose());
+            const auto count = static_cast<Eigen::Index>(std::min<std::size_t>(day + 1, window));
+            CHECK(rolling.getCount() == static_cast<std::size_t>(count));
+            if (count < 2)
+            {
+                continue;
+            }
+
+            const Eigen::MatrixXd days = returns.middleRows(day + 1 - count, count);
+            const Eigen::MatrixXd expected = directCovariance(days);
+            CHECK((rolling.getMean() - days.colwise().mean().transpose()).cwiseAbs().maxCoeff() < 1e-15);
+            CHECK((rolling.getCovariance() - expected).cwiseAbs().maxCoeff() < 1e-12 * expected.cwiseAbs().maxCoeff());
+        }
+    }
+
+    // Sigma = sum(w_t * r_t * r_t^T) / sum(w_t) with w_t = lambda^(T - 1 - t), annualized
+    void ewmaCovarianceMatchesTheWeightedSum()
+    {
+        constexpr double lambda { 0.94 };
+        const Eigen::MatrixXd returns = makeReturns(120, 5);
+        EwmaCovariance ewma(5, lambda);
+        ewma.addDays(returns);
+        CHECK(ewma.getCount() == 120);
+
+        Eigen::MatrixXd weighted_sum = Eigen::MatrixXd::Zero(5, 5);
+        Eigen::VectorXd weighted_returns = Eigen::VectorXd::Zero(5);
+        double weight_sum = 0.0;
+        for (Eigen::Index day = 0; day < returns.rows(); ++day)
+        {
+            const double weight = std::pow(lambda, static_cast<double>(returns.rows() - 1 - day));
+            const Eigen::VectorXd r = returns.row(day).transpose();
+            weighted_sum += weight * r * r.transpose();
+            weighted_returns += weight * r;
+            weight_sum += weight;
+        }
+        const Eigen::MatrixXd expected = weighted_sum * (252.0 / weight_sum);
+        CHECK((ewma.getCovariance() - expected).cwiseAbs().maxCoeff() < 1e-12 * expected.cwiseAbs().maxCoeff());
+        CHECK((ewma.getMean() - weighted_returns / weight_sum).cwiseAbs().maxCoeff() < 1e-15);
+
+        CHECK_THROWS(EwmaCovariance(5, 1.0), std::invalid_argument);
+        CHECK_THROWS(EwmaCovariance(5).getCovariance(), std::logic_error);
+    }
+
+    // tiles of columns on the pool, panels of days: same estimate as the direct one, for sizes that aren't multiples
+    // of the tiles and with a mean that is large compared with the deviations
+    void tiledCovarianceMatchesTheDirectEstimate()
+    {
+        ThreadPool pool(3);
+        for (const Eigen::Index assets : { 1, 7, 70, 131 })
+        {
+            Eigen::MatrixXd returns = makeReturns(301, assets);
+            returns.array() += 10.0;
+
+            const ReturnStatistics tiled = computeReturnStatistics(returns, pool);
+            const ReturnStatistics serial = computeReturnStatistics(returns);
+            const Eigen::MatrixXd expected = directCovariance(returns);
+            CHECK((tiled.mean - returns.colwise().mean().transpose()).cwiseAbs().maxCoeff() < 1e-13);
+            CHECK((tiled.covariance - expected).cwiseAbs().maxCoeff() < 1e-10 * expected.cwiseAbs().maxCoeff());
+            CHECK(tiled.covariance == tiled.covariance.transpose());
+            CHECK(tiled.covariance == serial.covariance);
+        }
+    }
+
+    // the accessors of the portfolio are views: the returns of a store-backed portfolio are the mapped columns
+    void portfolioAccessorsDontCopy()
+    {
+        const Eigen::MatrixXd returns = makeReturns(40, 3);
+        const MultiEquityPortfolio owned(returns, Eigen::VectorXd::Constant(3, 100.0), { "A", "B", "C" }, std::vector<std::uint16_t>(3, 1));
+        CHECK(owned.getReturnMatrix().data() == owned.getReturnMatrix().data());
+        CHECK(owned.getTickerReturns(2).data() == owned.getReturnMatrix().col(2).data());
+
+        const std::string path = TestData::makeDirectory("CovarianceEstimatorTest", "portfolioAccessorsDontCopy") + "/market.mds";
+        std::vector<std::int32_t> dates(40);
+        for (std::size_t i = 0; i < dates.size(); ++i)
+        {
+            dates[i] = 20240101 + static_cast<std::int32_t>(i % 28) + 100 * static_cast<std::int32_t>(i / 28);
+        }
+        MarketDataStore::create(path, { "A", "B", "C" }, dates, returns, Eigen::VectorXd::Constant(3, 100.0));
+        const auto store = std::make_shared<const MarketDataStore>(path);
+        const MultiEquityPortfolio mapped(store, std::vector<std::uint16_t>(3, 1));
+
+        CHECK(mapped.getReturnMatrix().data() == store->getReturns().data());
+        CHECK(mapped.getReturnMatrix().outerStride() == store->getReturns().outerStride());
+        CHECK(mapped.getTickerReturns(1).data() == store->getReturns().col(1).data());
+        CHECK(mapped.getReturnMatrix() == returns);
+        CHECK((mapped.getReturnCovarianceMatrix() - owned.getReturnCovarianceMatrix()).cwiseAbs().maxCoeff() == 0.0);
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "rollingCovarianceMatchesTheWindow", rollingCovarianceMatchesTheWindow },
+        { "ewmaCovarianceMatchesTheWeightedSum", ewmaCovarianceMatchesTheWeightedSum },
+        { "tiledCovarianceMatchesTheDirectEstimate", tiledCovarianceMatchesTheDirectEstimate },
+        { "portfolioAccessorsDontCopy", portfolioAccessorsDontCopy },
+    });
+}
@@ -0,0 +1,157 @@
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "CovarianceModel.h"
+#include "MultiEquityPortfolio.h"
+#include "TestCheck.h"
+
+namespace
+{
+    // well-conditioned covariance: B * B^T plus a diagonal
+    Eigen::MatrixXd makeCovariance(const Eigen::Index n)
+    {
+        Eigen::MatrixXd loadings(n, 3);
+        for (Eigen::Index i = 0; i < n; ++i)
+        {
+            for (Eigen::Index k = 0; k < 3; ++k)
+            {
+                loadings(i, k) = 0.1 * std::sin(1.7 * static_cast<double>(i) + 2.3 * static_cast<double>(k));
+            }
+        }
+        Eigen::MatrixXd covariance = loadings * loadings.transpose();
+        covariance.diagonal().array() += 0.02;
+        return covariance;
+    }
+
+    double distanceToLLT(const CholeskyModel& model, const Eigen::MatrixXd& covariance)
+    {
+        const Eigen::MatrixXd expected = Eigen::LLT<Eigen::MatrixXd>(covariance).matrixL();
+        return (model.getCholeskyLower() - expected).cwiseAbs().maxCoeff();
+    }
+
+    void appendAssetMatchesAFullFactorization()
+    {
+        const Eigen::MatrixXd covariance = makeCovariance(30);
+        CholeskyModel model = CholeskyModel::fromCovariance(covariance.topLeftCorner(24, 24));
+        for (Eigen::Index n = 24; n < 30; ++n)
+        {
+            model.appendAsset(covariance.col(n).head(n + 1));
+            CHECK(model.getAssetCount() == n + 1);
+            CHECK(distanceToLLT(model, covariance.topLeftCorner(n + 1, n + 1)) < 1e-14);
+        }
+    }
+
+    void removeAssetMatchesAFullFactorization()
+    {
+        Eigen::MatrixXd covariance = makeCovariance(30);
+        CholeskyModel model = CholeskyModel::fromCovariance(covariance);
+        // first, middle and last asset
+        for (const Eigen::Index index : { Eigen::Index{ 0 }, Eigen::Index{ 13 }, Eigen::Index{ 27 } })
+        {
+            model.removeAsset(index);
+
+            const Eigen::Index n = covariance.rows() - 1;
+            Eigen::MatrixXd remaining(n, n);
+            for (Eigen::Index j = 0, source_j = 0; j < n; ++j, ++source_j)
+            {
+                source_j += source_j == index ? 1 : 0;
+                for (Eigen::Index i = 0, source_i = 0; i < n; ++i, ++source_i)
+                {
+                    source_i += source_i == index ? 1 : 0;
+                    remaining(i, j) = covariance(source_i, source_j);
+                }
+            }
+            covariance = remaining;
+
+            CHECK(model.getAssetCount() == n);
+            CHECK(distanceToLLT(model, covariance) < 1e-14);
+        }
+    }
+
+    void appendAssetRejectsAnIndefiniteCovariance()
+    {
+        const Eigen::MatrixXd covariance = makeCovariance(5);
+        CholeskyModel model = CholeskyModel::fromCovariance(covariance);
+
+        // the new asset moves like asset 2 with half its variance: a correlation above 1
+        Eigen::VectorXd column(6);
+        column << covariance.col(2), 0.5 * covariance(2, 2);
+        CHECK_THROWS(model.appendAsset(column), std::invalid_argument);
+        CHECK(model.getAssetCount() == 5);
+    }
+
+    // antithetic runs correlate the draw z once and give -shocks to the mirrored simulation: the models are linear,
+    // the shocks of -z must be exactly the negated shocks of z (rows 2i and 2i + 1)
+    void mirroredNormalsGiveNegatedShocks()
+    {
+        Eigen::MatrixXd returns(120, 12);
+        for (Eigen::Index j = 0; j < returns.cols(); ++j)
+        {
+            for (Eigen::Index i = 0; i < returns.rows(); ++i)
+            {
+                returns(i, j) = 0.01 * std::sin(0.7 * static_cast<double>(i) + 1.3 * static_cast<double>(j))
+                    + 0.004 * std::cos(0.31 * static_cast<double>(i * (j + 1)));
+            }
+        }
+        const auto check_mirror = [](const CovarianceModel& model)
+        {
+            Eigen::MatrixXd normals(300, model.getNormalCount());
+            for (Eigen::Index i = 0; i < normals.rows(); i += 2)
+            {
+                for (Eigen::Index k = 0; k < normals.cols(); ++k)
+                {
+                    normals(i, k) = 2.5 * std::sin(0.37 * static_cast<double>(i * normals.cols() + k));
+                    normals(i + 1, k) = -normals(i, k);
+                }
+            }
+
+            Eigen::MatrixXd shocks(normals.rows(), model.getAssetCount());
+            model.correlate(normals, shocks);
+            for (Eigen::Index i = 0; i < shocks.rows(); i += 2)
+            {
+                CHECK(shocks.row(i + 1) == -shocks.row(i));
+            }
+        };
+        check_mirror(CholeskyModel::fromCovariance(makeCovariance(12)));
+        check_mirror(FactorModel::fromReturns(returns, 3));
+    }
+
+    // the portfolio gives the covariance column of a new ticker, the factor of the model follows the portfolio
+    void portfolioTickersFollowTheFactor()
+    {
+        Eigen::MatrixXd returns(80, 5);
+        for (Eigen::Index j = 0; j < returns.cols(); ++j)
+        {
+            for (Eigen::Index i = 0; i < returns.rows(); ++i)
+            {
+                returns(i, j) = 0.01 * std::sin(0.7 * static_cast<double>(i) + 1.3 * static_cast<double>(j))
+                    + 0.004 * std::cos(0.31 * static_cast<double>(i * (j + 1)));
+            }
+        }
+        MultiEquityPortfolio portfolio(returns.leftCols(4), Eigen::VectorXd::Constant(4, 100.0), { "A", "B", "C", "D" },
+            std::vector<std::uint16_t>(4, 1));
+        CholeskyModel model = CholeskyModel::fromCovariance(portfolio.getReturnCovarianceMatrix());
+
+        portfolio.addTicker("E", returns.col(4), 50.0, 2);
+        model.appendAsset(portfolio.getCovarianceColumn(portfolio.getTickerIndex("E")));
+        CHECK(distanceToLLT(model, portfolio.getReturnCovarianceMatrix()) < 1e-14);
+
+        model.removeAsset(portfolio.getTickerIndex("B"));
+        portfolio.removeTicker("B");
+        CHECK((portfolio.getTickers() == std::vector<std::string>{ "A", "C", "D", "E" }));
+        CHECK(distanceToLLT(model, portfolio.getReturnCovarianceMatrix()) < 1e-14);
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "appendAssetMatchesAFullFactorization", appendAssetMatchesAFullFactorization },
+        { "removeAssetMatchesAFullFactorization", removeAssetMatchesAFullFactorization },
+        { "appendAssetRejectsAnIndefiniteCovariance", appendAssetRejectsAnIndefiniteCovariance },
+        { "mirroredNormalsGiveNegatedShocks", mirroredNormalsGiveNegatedShocks },
+        { "portfolioTickersFollowTheFactor", portfolioTickersFollowTheFactor },
+    });
+}
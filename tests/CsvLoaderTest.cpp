@@ -0,0 +1,289 @@
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "CsvLoader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "TestCheck.h"
+#include "TestData.h"
+
+namespace
+{
+    // three tickers over the days d0..d5: A has all of them, B misses d2, C starts at d1
+    std::vector<std::string> writeRaggedFiles(const std::string& name)
+    {
+        const std::string directory = TestData::makeDirectory("CsvLoaderTest", name);
+        const std::vector<std::int32_t> days = TestData::makeDates(6);
+        TestData::writeReturnCsv(directory + "/A.csv", days, std::vector<double>(6, 0.01), 10.0);
+        TestData::writeReturnCsv(directory + "/B.csv", {days[0], days[1], days[3], days[4], days[5]}, std::vector<double>(5, 0.02), 20.0);
+        TestData::writeReturnCsv(directory + "/C.csv", {days[1], days[2], days[3], days[4], days[5]}, std::vector<double>(5, 0.03), 30.0);
+        return {directory + "/A.csv", directory + "/B.csv", directory + "/C.csv"};
+    }
+
+    bool sameMatrix(const Eigen::MatrixXd& actual, const Eigen::MatrixXd& expected)
+    {
+        if (actual.rows() != expected.rows() || actual.cols() != expected.cols())
+        {
+            return false;
+        }
+        for (Eigen::Index k = 0; k < actual.size(); ++k)
+        {
+            const double a = actual.data()[k];
+            const double e = expected.data()[k];
+            if (std::isnan(a) != std::isnan(e) || (!std::isnan(e) && std::abs(a - e) > 1e-15))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // only the dates every ticker has, the returns of a dropped date are added to the next kept one
+    void dropKeepsTheCommonDates()
+    {
+        ThreadPool pool(2);
+        const std::vector<std::int32_t> days = TestData::makeDates(6);
+        const ReturnData data = loadReturnData(writeRaggedFiles("dropKeepsTheCommonDates"), pool, MissingDates::Drop);
+
+        CHECK((data.dates == std::vector<std::int32_t>{days[1], days[3], days[4], days[5]}));
+        Eigen::MatrixXd expected(4, 3);
+        expected << 0.01, 0.02, 0.03,
+                    0.02, 0.02, 0.06,
+                    0.01, 0.02, 0.03,
+                    0.01, 0.02, 0.03;
+        CHECK(sameMatrix(data.log_returns, expected));
+        CHECK_NEAR(data.last_prices(0), 10.0 * std::exp(0.06), 1e-12);
+        CHECK_NEAR(data.last_prices(1), 20.0 * std::exp(0.10), 1e-12);
+        CHECK_NEAR(data.last_prices(2), 30.0 * std::exp(0.15), 1e-12);
+    }
+
+    // the dates after the last common one are dropped: the last prices are the closes of that date, which match the
+    // aligned returns
+    void dropEndsAtTheLastCommonDate()
+    {
+        const std::string directory = TestData::makeDirectory("CsvLoaderTest", "dropEndsAtTheLastCommonDate");
+        const std::vector<std::int32_t> days = TestData::makeDates(6);
+        TestData::writeReturnCsv(directory + "/A.csv", days, std::vector<double>(6, 0.01), 10.0);
+        TestData::writeReturnCsv(directory + "/B.csv", std::vector<std::int32_t>(days.begin(), days.end() - 2), std::vector<double>(4, 0.02), 20.0);
+
+        ThreadPool pool(2);
+        const ReturnData data = loadReturnData({directory + "/A.csv", directory + "/B.csv"}, pool, MissingDates::Drop);
+        CHECK(data.dates.back() == days[3]);
+        CHECK_NEAR(data.last_prices(0), 10.0 * std::exp(0.04), 1e-12);
+        CHECK_NEAR(data.last_prices(1), 20.0 * std::exp(0.08), 1e-12);
+    }
+
+    // from the first date of the latest ticker, a missing day keeps the last price (log return 0)
+    void forwardFillStartsAtTheLatestFirstDate()
+    {
+        ThreadPool pool(2);
+        const std::vector<std::int32_t> days = TestData::makeDates(6);
+        const ReturnData data = loadReturnData(writeRaggedFiles("forwardFillStartsAtTheLatestFirstDate"), pool, MissingDates::ForwardFill);
+
+        CHECK((data.dates == std::vector<std::int32_t>(days.begin() + 1, days.end())));
+        Eigen::MatrixXd expected(5, 3);
+        expected << 0.01, 0.02, 0.03,
+                    0.01, 0.0, 0.03,
+                    0.01, 0.02, 0.03,
+                    0.01, 0.02, 0.03,
+                    0.01, 0.02, 0.03;
+        CHECK(sameMatrix(data.log_returns, expected));
+    }
+
+    // every date of every ticker, NaN where a ticker has no price
+    void pairwiseKeepsEveryDate()
+    {
+        ThreadPool pool(2);
+        const double nan = std::nan("");
+        const ReturnData data = loadReturnData(writeRaggedFiles("pairwiseKeepsEveryDate"), pool, MissingDates::Pairwise);
+
+        CHECK(data.dates == TestData::makeDates(6));
+        Eigen::MatrixXd expected(6, 3);
+        expected << 0.01, 0.02, nan,
+                    0.01, 0.02, 0.03,
+                    0.01, nan, 0.03,
+                    0.01, 0.02, 0.03,
+                    0.01, 0.02, 0.03,
+                    0.01, 0.02, 0.03;
+        CHECK(sameMatrix(data.log_returns, expected));
+    }
+
+    // files with the same dates are aligned in place, whatever the policy
+    void sameDatesGiveTheParsedColumns()
+    {
+        const std::string directory = TestData::makeDirectory("CsvLoaderTest", "sameDatesGiveTheParsedColumns");
+        const std::vector<std::int32_t> days = TestData::makeDates(40);
+        std::vector<double> a;
+        std::vector<double> b;
+        for (std::size_t i = 0; i < days.size(); ++i)
+        {
+            a.push_back(0.001 * static_cast<double>(i % 7) - 0.003);
+            b.push_back(0.002 * static_cast<double>(i % 5) - 0.004);
+        }
+        TestData::writeReturnCsv(directory + "/A.csv", days, a);
+        TestData::writeReturnCsv(directory + "/B.csv", days, b);
+
+        ThreadPool pool(2);
+        for (const MissingDates policy : {MissingDates::Drop, MissingDates::ForwardFill, MissingDates::Pairwise})
+        {
+            const ReturnData data = loadReturnData({directory + "/A.csv", directory + "/B.csv"}, pool, policy);
+            CHECK(data.dates == days);
+            CHECK(data.log_returns.col(0) == Eigen::Map<const Eigen::VectorXd>(a.data(), 40));
+            CHECK(data.log_returns.col(1) == Eigen::Map<const Eigen::VectorXd>(b.data(), 40));
+        }
+    }
+
+    void invalidFilesAreRejected()
+    {
+        const std::string directory = TestData::makeDirectory("CsvLoaderTest", "invalidFilesAreRejected");
+        const std::vector<std::int32_t> days = TestData::makeDates(10);
+        TestData::writeReturnCsv(directory + "/early.csv", std::vector<std::int32_t>(days.begin(), days.begin() + 5), std::vector<double>(5, 0.01));
+        TestData::writeReturnCsv(directory + "/late.csv", std::vector<std::int32_t>(days.begin() + 5, days.end()), std::vector<double>(5, 0.01));
+        TestData::writeReturnCsv(directory + "/unsorted.csv", {days[0], days[2], days[1]}, std::vector<double>(3, 0.01));
+
+        ThreadPool pool(2);
+        CHECK_THROWS(loadReturnData({directory + "/early.csv", directory + "/late.csv"}, pool, MissingDates::Drop), std::runtime_error);
+        CHECK_THROWS(loadReturnData({directory + "/early.csv", directory + "/unsorted.csv"}, pool), std::runtime_error);
+        CHECK_THROWS(loadReturnData({directory + "/early.csv", directory + "/missing.csv"}, pool), std::runtime_error);
+    }
+
+    std::string writeText(const std::string& path, const std::string& text)
+    {
+        std::ofstream(path, std::ios::binary) << text;
+        return text;
+    }
+
+    // CRLF line endings, empty lines and no newline at the end: the tail starts at the first row of the window
+    void csvTailSkipsTheLineEndings()
+    {
+        const std::string directory = TestData::makeDirectory("CsvLoaderTest", "csvTailSkipsTheLineEndings");
+        const std::string text = writeText(directory + "/crlf.csv", "Date,Close,Returns,Log Returns\r\n"
+            "2024-01-01,100,0,0\r\n"
+            "2024-01-02,101,0.01,0.00995\r\n"
+            "\r\n"
+            "2024-01-03,102,0.0099,0.00985\r\n"
+            "2024-01-04,103,0.0098,0.00976");
+        const MappedFile file(directory + "/crlf.csv");
+        CHECK(countCsvRows(file) == 4);
+
+        const CsvTail last_two = findCsvTail(file, 2);
+        CHECK(last_two.rows == 2);
+        CHECK(text.compare(last_two.offset, 10, "2024-01-03") == 0);
+
+        // the empty line isn't a row
+        const CsvTail last_three = findCsvTail(file, 3);
+        CHECK(last_three.rows == 3);
+        CHECK(text.compare(last_three.offset, 10, "2024-01-02") == 0);
+
+        // a window longer than the file: every row
+        const CsvTail all = findCsvTail(file, 100);
+        CHECK(all.rows == 4);
+        CHECK(text.compare(all.offset, 10, "2024-01-01") == 0);
+
+        writeText(directory + "/empty.csv", "Date,Close,Returns,Log Returns\n");
+        CHECK(findCsvTail(MappedFile(directory + "/empty.csv"), 5).rows == 0);
+    }
+
+    // the rows of the tail are parsed like the end of the whole file, the errors give the line in the file
+    void csvTailParsesTheLastRows()
+    {
+        const std::string directory = TestData::makeDirectory("CsvLoaderTest", "csvTailParsesTheLastRows");
+        const std::vector<std::int32_t> days = TestData::makeDates(30);
+        std::vector<double> returns;
+        for (std::size_t i = 0; i < days.size(); ++i)
+        {
+            returns.push_back(0.001 * static_cast<double>(i % 9) - 0.004);
+        }
+        TestData::writeReturnCsv(directory + "/A.csv", days, returns);
+
+        const MappedFile file(directory + "/A.csv");
+        std::vector<double> all(30);
+        const double last_close = parseReturnCsv(file, all);
+        const CsvTail tail = findCsvTail(file, 8);
+        std::vector<double> last(tail.rows);
+        std::vector<std::int32_t> dates(tail.rows);
+        CHECK(parseReturnCsv(file, last, {}, dates, tail.offset) == last_close);
+        CHECK((last == std::vector<double>(all.end() - 8, all.end())));
+        CHECK((dates == std::vector<std::int32_t>(days.end() - 8, days.end())));
+
+        // invalid number on line 29 of the file (header + 27 rows before it)
+        writeText(directory + "/bad.csv", [&days]
+        {
+            std::string text = "Date,Close,Returns,Log Returns\n";
+            for (std::size_t i = 0; i < days.size(); ++i)
+            {
+                text += TestData::formatDate(days[i]) + (i == 27 ? ",100,0,oops\n" : ",100,0,0\n");
+            }
+            return text;
+        }());
+        const MappedFile bad(directory + "/bad.csv");
+        const CsvTail bad_tail = findCsvTail(bad, 5);
+        std::vector<double> bad_returns(bad_tail.rows);
+        std::string message;
+        try
+        {
+            parseReturnCsv(bad, bad_returns, {}, {}, bad_tail.offset);
+        } catch (const std::runtime_error& error) {
+            message = error.what();
+        }
+        CHECK(message.find("bad.csv:29:") != std::string::npos);
+    }
+
+    // a lookback reads the last rows of every file before the merge: the last rows of the full load
+    void lookbackLoadsTheLastRows()
+    {
+        const std::string directory = TestData::makeDirectory("CsvLoaderTest", "lookbackLoadsTheLastRows");
+        const std::vector<std::int32_t> days = TestData::makeDates(50);
+        std::vector<double> a;
+        std::vector<double> b;
+        for (std::size_t i = 0; i < days.size(); ++i)
+        {
+            a.push_back(0.001 * static_cast<double>(i % 7) - 0.003);
+            b.push_back(0.002 * static_cast<double>(i % 5) - 0.004);
+        }
+        TestData::writeReturnCsv(directory + "/A.csv", days, a);
+        // B starts later and misses one of the last days
+        std::vector<std::int32_t> b_days(days.begin() + 10, days.end());
+        std::vector<double> b_returns(b.begin() + 10, b.end());
+        b_days.erase(b_days.end() - 3);
+        b_returns.erase(b_returns.end() - 3);
+        TestData::writeReturnCsv(directory + "/B.csv", b_days, b_returns);
+        const std::vector<std::string> paths { directory + "/A.csv", directory + "/B.csv" };
+
+        ThreadPool pool(2);
+        for (const MissingDates policy : {MissingDates::Drop, MissingDates::ForwardFill, MissingDates::Pairwise})
+        {
+            const ReturnData full = loadReturnData(paths, pool, policy);
+            const ReturnData recent = loadReturnData(paths, pool, policy, 12);
+            // A has the 12 last days, B 12 rows from one day earlier: the common part is the last 11 dates
+            const auto rows = static_cast<Eigen::Index>(policy == MissingDates::Drop ? 10 : 11);
+            CHECK(recent.log_returns.rows() >= rows);
+            CHECK((recent.dates == std::vector<std::int32_t>(full.dates.end() - recent.log_returns.rows(), full.dates.end())));
+            CHECK(sameMatrix(recent.log_returns.bottomRows(rows), full.log_returns.bottomRows(rows)));
+            CHECK(recent.last_prices == full.last_prices);
+        }
+
+        // a lookback longer than the files reads them whole
+        const ReturnData whole = loadReturnData(paths, pool, MissingDates::Pairwise, 1000);
+        CHECK(sameMatrix(whole.log_returns, loadReturnData(paths, pool, MissingDates::Pairwise).log_returns));
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "dropKeepsTheCommonDates", dropKeepsTheCommonDates },
+        { "dropEndsAtTheLastCommonDate", dropEndsAtTheLastCommonDate },
+        { "forwardFillStartsAtTheLatestFirstDate", forwardFillStartsAtTheLatestFirstDate },
+        { "pairwiseKeepsEveryDate", pairwiseKeepsEveryDate },
+        { "sameDatesGiveTheParsedColumns", sameDatesGiveTheParsedColumns },
+        { "invalidFilesAreRejected", invalidFilesAreRejected },
+        { "csvTailSkipsTheLineEndings", csvTailSkipsTheLineEndings },
+        { "csvTailParsesTheLastRows", csvTailParsesTheLastRows },
+        { "lookbackLoadsTheLastRows", lookbackLoadsTheLastRows },
+    });
+}
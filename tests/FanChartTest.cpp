@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "FanChart.h"
+#include "MonteCarloEngine.h"
+#include "PathMatrix.h"
+#include "ThreadPool.h"
+#include "TestCheck.h"
+#include "TestData.h"
+
+namespace
+{
+    // percentile() of a sorted copy: interpolated between the two values around (percent / 100) * (n - 1)
+    double sortedPercentile(const std::vector<std::float_t>& sorted, const std::float_t percent)
+    {
+        const double index = (static_cast<double>(percent) / 100.0) * static_cast<double>(sorted.size() - 1);
+        const auto lower = static_cast<std::size_t>(index);
+        if (lower + 1 >= sorted.size())
+        {
+            return sorted.back();
+        }
+        return sorted[lower] + (index - static_cast<double>(lower)) * (sorted[lower + 1] - sorted[lower]);
+    }
+
+    std::vector<std::float_t> sortedRow(const PathMatrix& paths, const std::size_t step)
+    {
+        std::vector<std::float_t> row(paths.row(step).begin(), paths.row(step).end());
+        std::sort(row.begin(), row.end());
+        return row;
+    }
+
+    // the partial selections of every band (in ascending order of percent, whatever the order of the input)
+    // give the same values as a full sort of the row
+    void bandsMatchAFullSortOfEveryRow()
+    {
+        std::mt19937 generator(42);
+        std::lognormal_distribution<std::float_t> distribution(4.6f, 0.2f);
+        PathMatrix paths(6, 1001);
+        for (std::size_t step = 0; step < paths.getRows(); ++step)
+        {
+            for (std::float_t& value : paths.row(step))
+            {
+                value = distribution(generator);
+            }
+        }
+        // ties
+        std::fill(paths.row(5).begin(), paths.row(5).begin() + 500, 100.0f);
+
+        PathMatrix copy = paths;
+        const std::vector<std::float_t> percents { 95.0f, 1.0f, 50.0f, 0.0f, 37.5f, 100.0f, 5.0f, 99.0f };
+        ThreadPool pool(3);
+        const FanChart fan_chart = computeFanChart(copy, percents, pool);
+
+        CHECK(fan_chart.percents == percents);
+        for (std::size_t step = 0; step < paths.getRows(); ++step)
+        {
+            const std::vector<std::float_t> sorted = sortedRow(paths, step);
+            for (std::size_t k = 0; k < percents.size(); ++k)
+            {
+                CHECK_NEAR(fan_chart.bands[k][step], sortedPercentile(sorted, percents[k]), 1e-4);
+            }
+        }
+        CHECK_THROWS(computeFanChart(copy, { 101.0f }, pool), std::invalid_argument);
+    }
+
+    // with 2^24 + 4 values a float index of the 100% band rounds up to the size: it must stay inside the row
+    void bandsStayInsideLongRows()
+    {
+        PathMatrix paths(1, (std::size_t{ 1 } << 24) + 4);
+        std::iota(paths.row(0).rbegin(), paths.row(0).rend(), 0.0f);
+        const std::float_t largest = *std::max_element(paths.row(0).begin(), paths.row(0).end());
+
+        ThreadPool pool(1);
+        const FanChart fan_chart = computeFanChart(paths, { 0.0f, 100.0f }, pool);
+        CHECK(fan_chart.bands[0][0] == 0.0f);
+        CHECK(fan_chart.bands[1][0] == largest);
+    }
+
+    // one line per day: the day and the bands in the order of the percents
+    void writtenFileHasOneLinePerDay()
+    {
+        const std::string directory = TestData::makeDirectory("FanChartTest", "written");
+        const FanChart fan_chart{ { 5.0f, 37.5f }, { { 90.0f, 91.5f, 92.25f }, { 100.0f, 101.0f, 102.0f } } };
+        writeFanChart(fan_chart, directory + "/fan_chart.csv");
+
+        std::ifstream file(directory + "/fan_chart.csv");
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(file, line);)
+        {
+            lines.push_back(line);
+        }
+        CHECK(lines == std::vector<std::string>({ "day,5,37.5", "0,90,100", "1,91.5,101", "2,92.25,102" }));
+        CHECK_THROWS(writeFanChart(fan_chart, directory + "/missing/fan_chart.csv"), std::runtime_error);
+    }
+
+    // simulateFanChart() draws the same paths as simulatePaths(): every band is the order statistic at rank
+    // floor(percent / 100 * (n - 1)) within the accuracy of the sketch, the interpolated exact band is at most one
+    // order statistic further
+    void streamingBandsMatchTheExactBands()
+    {
+        const SingleEquityEngine engine(100.0f, 0.0003f, 0.02f);
+        SimulationConfig config;
+        config.simulations = 20000;
+        config.trading_days = 10;
+        config.seed = 99;
+        config.chunk_size = 512;
+        constexpr double accuracy { 0.001 };
+        // the prices are floats
+        constexpr double rounding { 1e-6 };
+
+        ThreadPool pool(4);
+        const PathMatrix paths = engine.simulatePaths(config, pool);
+        PathMatrix copy = paths;
+        const std::vector<std::float_t> percents { 1.0f, 5.0f, 50.0f, 95.0f, 99.0f };
+        const FanChart exact = computeFanChart(copy, percents, pool);
+        const FanChart streaming = engine.simulateFanChart(config, pool, accuracy).getFanChart(percents);
+
+        CHECK(streaming.bands.size() == percents.size());
+        for (std::size_t step = 0; step < paths.getRows(); ++step)
+        {
+            const std::vector<std::float_t> sorted = sortedRow(paths, step);
+            for (std::size_t k = 0; k < percents.size(); ++k)
+            {
+                const auto rank = static_cast<std::size_t>((percents[k] / 100.0) * static_cast<double>(sorted.size() - 1));
+                const double tolerance = (accuracy + rounding) * sorted[rank];
+                const double band = streaming.bands[k][step];
+                CHECK_NEAR(band, sorted[rank], tolerance);
+                CHECK_NEAR(band, exact.bands[k][step], tolerance + (sorted[rank + 1] - sorted[rank]));
+            }
+        }
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "bandsMatchAFullSortOfEveryRow", bandsMatchAFullSortOfEveryRow },
+        { "bandsStayInsideLongRows", bandsStayInsideLongRows },
+        { "writtenFileHasOneLinePerDay", writtenFileHasOneLinePerDay },
+        { "streamingBandsMatchTheExactBands", streamingBandsMatchTheExactBands },
+    });
+}
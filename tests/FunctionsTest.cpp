@@ -0,0 +1,41 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+#include "functions.h"
+#include "TestCheck.h"
+
+namespace
+{
+    // interpolated between the two values around (percent / 100) * (n - 1) in sorted order
+    void percentileInterpolatesTheSortedValues()
+    {
+        const std::vector<std::float_t> data { 5.0f, 1.0f, 4.0f, 2.0f, 3.0f };
+        CHECK(percentile(data, 0.0f) == 1.0f);
+        CHECK(percentile(data, 50.0f) == 3.0f);
+        CHECK(percentile(data, 100.0f) == 5.0f);
+        CHECK_NEAR(percentile(data, 10.0f), 1.4f, 1e-6);
+        CHECK_NEAR(percentile(data, 95.0f), 4.8f, 1e-6);
+        CHECK(percentile({ 7.0f }, 30.0f) == 7.0f);
+    }
+
+    // with 2^24 + 4 values the float index of the last element (2^24 + 3) rounds up to the size: it must stay inside the data
+    void percentileStaysInsideLargeData()
+    {
+        std::vector<std::float_t> data((std::size_t{ 1 } << 24) + 4);
+        std::iota(data.begin(), data.end(), 0.0f);
+        std::reverse(data.begin(), data.end());
+        const std::float_t largest = *std::max_element(data.begin(), data.end());
+        CHECK(percentileInPlace(data, 100.0f) == largest);
+        CHECK(percentileInPlace(data, 0.0f) == 0.0f);
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "percentileInterpolatesTheSortedValues", percentileInterpolatesTheSortedValues },
+        { "percentileStaysInsideLargeData", percentileStaysInsideLargeData },
+    });
+}
@@ -0,0 +1,57 @@
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "ImportPlugin.h"
+#include "TestCheck.h"
+
+// Built with MCVAR_WITH_PYTHON: MCVAR_PLUGIN_PATH is the mcvar_yfinance plugin and ctest sets
+// MCVAR_PROVIDER_MODULE=canned_provider (tests/canned_provider.py), so no data is downloaded
+namespace
+{
+    void checkSeries(const TickerBatch& batch, const std::size_t index, const std::vector<double>& log_returns,
+        const std::vector<double>& close_prices)
+    {
+        CHECK(batch.getLogReturns(index) == Eigen::Map<const Eigen::VectorXd>(log_returns.data(), static_cast<Eigen::Index>(log_returns.size())));
+        CHECK(batch.getClosePrices(index) == Eigen::Map<const Eigen::VectorXd>(close_prices.data(), static_cast<Eigen::Index>(close_prices.size())));
+    }
+
+    // two fetches in the same process: the second one finds the provider module already imported (its call counter
+    // is 2), and both batches stay readable until they are released
+    void fetchesShareTheInterpreter()
+    {
+        const ImportPlugin plugin(MCVAR_PLUGIN_PATH);
+        const std::vector<std::string> tickers { "AAA", "BBB", "COUNT" };
+
+        const TickerBatch first = plugin.fetchTickers(tickers);
+        CHECK(first.getTickers() == tickers);
+        CHECK(first.size() == 3);
+        checkSeries(first, 0, { 0.01, -0.02, 0.005 }, { 101.0, 99.0, 99.5 });
+        checkSeries(first, 1, { 0.0, 0.03 }, { 50.0, 51.5 });
+        checkSeries(first, 2, { 1.0 }, { 1.0 });
+
+        // opening the plugin again is cheap and keeps its state
+        const TickerBatch second = ImportPlugin(MCVAR_PLUGIN_PATH).fetchTickers({ "COUNT", "AAA" });
+        CHECK(second.size() == 2);
+        checkSeries(second, 0, { 2.0 }, { 2.0 });
+        checkSeries(second, 1, { 0.01, -0.02, 0.005 }, { 101.0, 99.0, 99.5 });
+        checkSeries(first, 0, { 0.01, -0.02, 0.005 }, { 101.0, 99.0, 99.5 });
+    }
+
+    // the exception of the provider comes back with the path of the plugin
+    void providerErrorsAreThrown()
+    {
+        const ImportPlugin plugin(MCVAR_PLUGIN_PATH);
+        CHECK_THROWS(plugin.fetchTickers({ "AAA", "MISSING" }), std::runtime_error);
+        CHECK_THROWS(ImportPlugin("missing_plugin.so"), std::runtime_error);
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "fetchesShareTheInterpreter", fetchesShareTheInterpreter },
+        { "providerErrorsAreThrown", providerErrorsAreThrown },
+    });
+}
@@ -0,0 +1,154 @@
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "MarketDataStore.h"
+#include "ThreadPool.h"
+#include "TestCheck.h"
+#include "TestData.h"
+
+namespace
+{
+    const std::vector<std::string> TICKERS = {"AAA", "BBB", "CCC"};
+
+    Eigen::MatrixXd makeReturns(const Eigen::Index days)
+    {
+        Eigen::MatrixXd returns(days, 3);
+        for (Eigen::Index j = 0; j < 3; ++j)
+        {
+            for (Eigen::Index i = 0; i < days; ++i)
+            {
+                returns(i, j) = 0.001 * static_cast<double>((i * 5 + j * 3) % 11) - 0.005;
+            }
+        }
+        return returns;
+    }
+
+    Eigen::VectorXd prices(const double a, const double b, const double c)
+    {
+        Eigen::VectorXd result(3);
+        result << a, b, c;
+        return result;
+    }
+
+    void roundTrip()
+    {
+        const std::string path = TestData::makeDirectory("MarketDataStoreTest", "roundTrip") + "/store.mcvar";
+        const std::vector<std::int32_t> dates = TestData::makeDates(10);
+        const Eigen::MatrixXd returns = makeReturns(10);
+        MarketDataStore::create(path, TICKERS, dates, returns, prices(1.0, 2.0, 3.0), MissingDates::ForwardFill, 7, 0, 99);
+
+        const MarketDataStore store(path);
+        CHECK(store.getTickers() == TICKERS);
+        CHECK(store.getDayCount() == 10);
+        CHECK(store.getDayCapacity() >= 10);
+        CHECK(store.getMissingDates() == MissingDates::ForwardFill);
+        CHECK(store.getLookback() == 7);
+        CHECK(store.getSourceHash() == 99);
+        CHECK(std::vector<std::int32_t>(store.getDates().begin(), store.getDates().end()) == dates);
+        CHECK(store.getReturns() == returns);
+        CHECK(store.getLastPrices() == prices(1.0, 2.0, 3.0));
+    }
+
+    void appendInPlaceThenRewrite()
+    {
+        const std::string path = TestData::makeDirectory("MarketDataStoreTest", "appendInPlaceThenRewrite") + "/store.mcvar";
+        const std::vector<std::int32_t> dates = TestData::makeDates(12);
+        const Eigen::MatrixXd returns = makeReturns(12);
+        MarketDataStore::create(path, TICKERS, std::span(dates).first(10), returns.topRows(10), prices(1.0, 2.0, 3.0),
+            MissingDates::Drop, 0, 11, 5);
+
+        // room for one more day: written in place
+        MarketDataStore::append(path, dates[10], returns.row(10).transpose(), prices(4.0, 5.0, 6.0));
+        {
+            const MarketDataStore store(path);
+            CHECK(store.getDayCount() == 11);
+            CHECK(store.getDayCapacity() == 11);
+            CHECK(store.getReturns() == returns.topRows(11));
+            CHECK(store.getLastPrices() == prices(4.0, 5.0, 6.0));
+        }
+
+        // full: rewritten with a larger capacity, same contents
+        MarketDataStore::append(path, dates[11], returns.row(11).transpose(), prices(7.0, 8.0, 9.0));
+        const MarketDataStore store(path);
+        CHECK(store.getDayCount() == 12);
+        CHECK(store.getDayCapacity() > 12);
+        CHECK(store.getSourceHash() == 5);
+        CHECK(std::vector<std::int32_t>(store.getDates().begin(), store.getDates().end()) == dates);
+        CHECK(store.getReturns() == returns);
+        CHECK(store.getLastPrices() == prices(7.0, 8.0, 9.0));
+
+        // dates must follow the last one, one value per ticker
+        CHECK_THROWS(MarketDataStore::append(path, dates[11], returns.row(11).transpose(), prices(7.0, 8.0, 9.0)), std::invalid_argument);
+        CHECK_THROWS(MarketDataStore::append(path, 20250101, Eigen::VectorXd::Zero(2), prices(7.0, 8.0, 9.0)), std::invalid_argument);
+    }
+
+    // the prices of a reader match its own day count whatever is appended afterwards
+    void openReaderKeepsItsPrices()
+    {
+        const std::string path = TestData::makeDirectory("MarketDataStoreTest", "openReaderKeepsItsPrices") + "/store.mcvar";
+        const std::vector<std::int32_t> dates = TestData::makeDates(12);
+        const Eigen::MatrixXd returns = makeReturns(12);
+        MarketDataStore::create(path, TICKERS, std::span(dates).first(10), returns.topRows(10), prices(1.0, 2.0, 3.0));
+
+        const MarketDataStore before(path);
+        MarketDataStore::append(path, dates[10], returns.row(10).transpose(), prices(4.0, 5.0, 6.0));
+        const MarketDataStore middle(path);
+        // reuses the price slot of the first reader
+        MarketDataStore::append(path, dates[11], returns.row(11).transpose(), prices(7.0, 8.0, 9.0));
+
+        CHECK(before.getDayCount() == 10);
+        CHECK(before.getLastPrices() == prices(1.0, 2.0, 3.0));
+        CHECK(middle.getDayCount() == 11);
+        CHECK(middle.getLastPrices() == prices(4.0, 5.0, 6.0));
+        CHECK(MarketDataStore(path).getLastPrices() == prices(7.0, 8.0, 9.0));
+    }
+
+    void openOrBuildChecksTheCsvFiles()
+    {
+        const std::string directory = TestData::makeDirectory("MarketDataStoreTest", "openOrBuildChecksTheCsvFiles");
+        const std::vector<std::int32_t> dates = TestData::makeDates(20);
+        const std::vector<double> flat(20, 0.0);
+        TestData::writeReturnCsv(directory + "/A.csv", dates, flat, 10.0);
+        TestData::writeReturnCsv(directory + "/B.csv", dates, flat, 20.0);
+        TestData::writeReturnCsv(directory + "/C.csv", dates, flat, 30.0);
+        TestData::writeReturnCsv(directory + "/C2.csv", dates, flat, 40.0);
+
+        ThreadPool pool(2);
+        const std::string path = directory + "/store.mcvar";
+        const std::vector<std::string> tickers = TICKERS;
+        const auto first = MarketDataStore::openOrBuild(path, tickers, {directory + "/A.csv", directory + "/B.csv", directory + "/C.csv"}, pool);
+        CHECK_NEAR(first->getLastPrices()(2), 30.0, 1e-12);
+
+        // same tickers, another file for one of them: rebuilt even though the store is newer than the files
+        const auto second = MarketDataStore::openOrBuild(path, tickers, {directory + "/A.csv", directory + "/B.csv", directory + "/C2.csv"}, pool);
+        CHECK_NEAR(second->getLastPrices()(2), 40.0, 1e-12);
+
+        // another lookback: rebuilt with the last rows only
+        const auto third = MarketDataStore::openOrBuild(path, tickers, {directory + "/A.csv", directory + "/B.csv", directory + "/C2.csv"}, pool,
+            MissingDates::Drop, 5);
+        CHECK(third->getLookback() == 5);
+        CHECK(third->getDayCount() == 5);
+    }
+
+    void truncatedStoreIsRejected()
+    {
+        const std::string path = TestData::makeDirectory("MarketDataStoreTest", "truncatedStoreIsRejected") + "/store.mcvar";
+        MarketDataStore::create(path, TICKERS, TestData::makeDates(10), makeReturns(10), prices(1.0, 2.0, 3.0));
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 64);
+        CHECK_THROWS(MarketDataStore store(path), std::runtime_error);
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "roundTrip", roundTrip },
+        { "appendInPlaceThenRewrite", appendInPlaceThenRewrite },
+        { "openReaderKeepsItsPrices", openReaderKeepsItsPrices },
+        { "openOrBuildChecksTheCsvFiles", openOrBuildChecksTheCsvFiles },
+        { "truncatedStoreIsRejected", truncatedStoreIsRejected },
+    });
+}
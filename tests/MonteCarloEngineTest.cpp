@@ -0,0 +1,228 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <Eigen/Dense>
+#include "MonteCarloEngine.h"
+#include "ThreadPool.h"
+#include "TestCheck.h"
+
+namespace
+{
+    MultiEquityEngine makeEngine()
+    {
+        Eigen::MatrixXd covariance(3, 3);
+        covariance << 0.04, 0.01, 0.0,
+                      0.01, 0.09, 0.02,
+                      0.0, 0.02, 0.0625;
+        Eigen::VectorXd drift(3);
+        drift << 0.0002, 0.0001, 0.0003;
+        Eigen::VectorXd last_prices(3);
+        last_prices << 200.0, 10.0, 150.0;
+        return MultiEquityEngine(Eigen::MatrixXd(Eigen::LLT<Eigen::MatrixXd>(covariance).matrixL()), drift, last_prices, {10, 15, 20});
+    }
+
+    SimulationConfig makeConfig()
+    {
+        SimulationConfig config;
+        config.simulations = 10000;
+        config.trading_days = 10;
+        config.seed = 1234;
+        return config;
+    }
+
+    // the normals are addressed by (seed, path, step, asset): the same seed gives the same losses bit for bit
+    // whatever the number of workers or the size of the chunks
+    void lossesDontDependOnTheThreadCount()
+    {
+        const MultiEquityEngine engine = makeEngine();
+        for (const bool path_dependent : { false, true })
+        {
+            SimulationConfig config = makeConfig();
+            config.path_dependent = path_dependent;
+            config.chunk_size = 512;
+
+            ThreadPool single(1);
+            ThreadPool several(4);
+            const Eigen::VectorXd expected = engine.simulateLosses(config, single);
+            CHECK(engine.simulateLosses(config, several) == expected);
+            CHECK(engine.simulateLosses(config, several) == expected);
+        }
+    }
+
+    void lossesDontDependOnTheChunking()
+    {
+        const MultiEquityEngine engine = makeEngine();
+        ThreadPool pool(3);
+        SimulationConfig config = makeConfig();
+        const Eigen::VectorXd expected = engine.simulateLosses(config, pool);
+
+        for (const std::int64_t chunk_size : { 256, 768, 4096, 20000 })
+        {
+            config.chunk_size = chunk_size;
+            CHECK(engine.simulateLosses(config, pool) == expected);
+        }
+
+        // another seed gives other losses
+        config.seed = 4321;
+        CHECK(engine.simulateLosses(config, pool) != expected);
+    }
+
+    // antithetic pairs never straddle two blocks or chunks: the losses stay reproducible bit for bit
+    void antitheticLossesDontDependOnTheThreadsOrTheChunking()
+    {
+        const MultiEquityEngine engine = makeEngine();
+        for (const bool path_dependent : { false, true })
+        {
+            SimulationConfig config = makeConfig();
+            config.antithetic = true;
+            config.path_dependent = path_dependent;
+            // odd: the last simulation has no mirror
+            config.simulations = 10001;
+
+            ThreadPool single(1);
+            ThreadPool several(4);
+            const Eigen::VectorXd expected = engine.simulateLosses(config, single);
+            CHECK(engine.simulateLosses(config, several) == expected);
+            for (const std::int64_t chunk_size : { 256, 768, 4096, 20000 })
+            {
+                config.chunk_size = chunk_size;
+                CHECK(engine.simulateLosses(config, several) == expected);
+            }
+
+            config.antithetic = false;
+            CHECK(engine.simulateLosses(config, several) != expected);
+        }
+    }
+
+    // one asset without drift: simulation 2p + 1 has the opposite log return of simulation 2p, so the products
+    // of their final values are the square of the initial value
+    void antitheticPairsAreMirrored()
+    {
+        const MultiEquityEngine engine(Eigen::MatrixXd::Constant(1, 1, 0.3), Eigen::VectorXd::Zero(1), Eigen::VectorXd::Constant(1, 50.0), { 2 });
+        SimulationConfig config = makeConfig();
+        config.antithetic = true;
+        config.path_dependent = true;
+
+        ThreadPool pool(2);
+        const Eigen::VectorXd losses = engine.simulateLosses(config, pool);
+        const double initial_value = engine.getInitialValue();
+        for (Eigen::Index p = 0; p + 1 < losses.size(); p += 2)
+        {
+            CHECK_NEAR((initial_value - losses(p)) * (initial_value - losses(p + 1)), initial_value * initial_value, 1e-9 * initial_value * initial_value);
+        }
+    }
+
+    // the test book is long three stocks over 10 days, close to linear in the shocks: the mirrored paths cancel most of
+    // the variance of the mean loss
+    void antitheticRunReducesTheMeanLossVariance()
+    {
+        const MultiEquityEngine engine = makeEngine();
+        ThreadPool pool(2);
+        SimulationConfig config = makeConfig();
+        config.simulations = 50000;
+
+        CHECK(engine.simulateRisk(config, pool, { 0.99 }).mean_loss_variance_ratio == 1.0);
+        config.antithetic = true;
+        CHECK(engine.simulateRisk(config, pool, { 0.99 }).mean_loss_variance_ratio > 10.0);
+    }
+
+    void pathsDontDependOnTheThreadCount()
+    {
+        const SingleEquityEngine engine(100.0f, 0.0003f, 0.2f);
+        SimulationConfig config = makeConfig();
+        config.simulations = 3000;
+        config.chunk_size = 256;
+
+        ThreadPool single(1);
+        ThreadPool several(4);
+        const PathMatrix expected = engine.simulatePaths(config, single);
+        const PathMatrix paths = engine.simulatePaths(config, several);
+        CHECK(paths.getRows() == expected.getRows());
+        CHECK(paths.getColumns() == expected.getColumns());
+        for (std::size_t step = 0; step < expected.getRows(); ++step)
+        {
+            for (std::size_t path = 0; path < expected.getColumns(); ++path)
+            {
+                CHECK(paths(step, path) == expected(step, path));
+            }
+        }
+    }
+
+    // the count of simulations is 64-bit: a run above 2^31 is split in chunks of whole blocks that cover it
+    void planCoversLargeRuns()
+    {
+        const MultiEquityEngine engine = makeEngine();
+        SimulationConfig config = makeConfig();
+        config.simulations = std::int64_t{ 3 } << 31;
+        config.chunk_size = 5000;
+
+        const ChunkPlan plan = engine.planRun(config, 4, { 0.99 });
+        CHECK(plan.worker_count == 4);
+        CHECK(plan.chunk_size % plan.block_size == 0);
+        CHECK(plan.chunk_size >= config.chunk_size);
+        CHECK(plan.chunk_count * plan.chunk_size >= config.simulations);
+        CHECK((plan.chunk_count - 1) * plan.chunk_size < config.simulations);
+        // 4 x 1% of 6.4e9 losses don't fit in 256 MiB: the run falls back to the quantile sketch
+        CHECK(!plan.exact_tail);
+        CHECK(plan.result_bytes + plan.worker_count * plan.workspace_bytes <= config.memory_budget);
+    }
+
+    void planStaysWithinTheBudget()
+    {
+        const MultiEquityEngine engine = makeEngine();
+        SimulationConfig config = makeConfig();
+        config.path_dependent = true;
+        config.trading_days = 250;
+        config.simulations = 1000000;
+
+        const ChunkPlan roomy = engine.planRun(config, 2, { 0.95 });
+        CHECK(roomy.exact_tail);
+        CHECK(roomy.block_size == config.block_size);
+        CHECK(roomy.steps_per_block == config.trading_days);
+
+        // a small budget shrinks the days correlated together, then the blocks, and 2 x 5% of the losses don't fit
+        config.memory_budget = std::size_t{ 256 } << 10;
+        const ChunkPlan tight = engine.planRun(config, 2, { 0.95 });
+        CHECK(tight.steps_per_block < roomy.steps_per_block);
+        CHECK(tight.worker_count * tight.workspace_bytes <= config.memory_budget / 2);
+        CHECK(!tight.exact_tail);
+    }
+
+    // the exact tail and the sketch give the same VaR and ES within the accuracy of the sketch
+    void sketchRunMatchesTheExactRun()
+    {
+        const MultiEquityEngine engine = makeEngine();
+        ThreadPool pool(2);
+        SimulationConfig config = makeConfig();
+        config.simulations = 50000;
+
+        const RiskReport exact = engine.simulateRisk(config, pool, { 0.95, 0.99 });
+        CHECK(exact.plan.exact_tail);
+
+        config.memory_budget = std::size_t{ 64 } << 10;
+        const RiskReport sketched = engine.simulateRisk(config, pool, { 0.95, 0.99 });
+        CHECK(!sketched.plan.exact_tail);
+        for (std::size_t i = 0; i < exact.measures.size(); ++i)
+        {
+            CHECK_NEAR(sketched.measures[i].value_at_risk, exact.measures[i].value_at_risk, 0.001 * std::abs(exact.measures[i].value_at_risk));
+            CHECK_NEAR(sketched.measures[i].expected_shortfall, exact.measures[i].expected_shortfall,
+                0.001 * std::abs(exact.measures[i].expected_shortfall));
+        }
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "lossesDontDependOnTheThreadCount", lossesDontDependOnTheThreadCount },
+        { "lossesDontDependOnTheChunking", lossesDontDependOnTheChunking },
+        { "antitheticLossesDontDependOnTheThreadsOrTheChunking", antitheticLossesDontDependOnTheThreadsOrTheChunking },
+        { "antitheticPairsAreMirrored", antitheticPairsAreMirrored },
+        { "antitheticRunReducesTheMeanLossVariance", antitheticRunReducesTheMeanLossVariance },
+        { "pathsDontDependOnTheThreadCount", pathsDontDependOnTheThreadCount },
+        { "planCoversLargeRuns", planCoversLargeRuns },
+        { "planStaysWithinTheBudget", planStaysWithinTheBudget },
+        { "sketchRunMatchesTheExactRun", sketchRunMatchesTheExactRun },
+    });
+}
@@ -0,0 +1,79 @@
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "CovarianceEstimator.h"
+#include "MultiEquityPortfolio.h"
+#include "TestCheck.h"
+
+namespace
+{
+    Eigen::MatrixXd makeReturns(const Eigen::Index days, const Eigen::Index assets)
+    {
+        Eigen::MatrixXd returns(days, assets);
+        for (Eigen::Index j = 0; j < assets; ++j)
+        {
+            for (Eigen::Index i = 0; i < days; ++i)
+            {
+                returns(i, j) = 0.01 * std::sin(0.7 * static_cast<double>(i) + 1.3 * static_cast<double>(j))
+                    + 0.004 * std::cos(0.31 * static_cast<double>(i * (j + 1)));
+            }
+        }
+        return returns;
+    }
+
+    MultiEquityPortfolio makePortfolio(Eigen::MatrixXd returns)
+    {
+        const Eigen::Index n = returns.cols();
+        std::vector<std::string> tickers;
+        for (Eigen::Index j = 0; j < n; ++j)
+        {
+            tickers.push_back("T" + std::to_string(j));
+        }
+        return MultiEquityPortfolio(std::move(returns), Eigen::VectorXd::Constant(n, 100.0), tickers, std::vector<std::uint16_t>(n, 1));
+    }
+
+    void covarianceColumnMatchesTheMatrix()
+    {
+        const MultiEquityPortfolio portfolio = makePortfolio(makeReturns(60, 4));
+        const Eigen::MatrixXd covariance = portfolio.getReturnCovarianceMatrix();
+        for (Eigen::Index j = 0; j < 4; ++j)
+        {
+            CHECK((portfolio.getCovarianceColumn(j) - covariance.col(j)).cwiseAbs().maxCoeff() < 1e-15);
+        }
+    }
+
+    // missing dates (MissingDates::Pairwise): same pair-by-pair estimator as the full matrix, no NaN
+    void covarianceColumnHandlesMissingReturns()
+    {
+        Eigen::MatrixXd returns = makeReturns(60, 4);
+        const double nan = std::nan("");
+        returns.block(0, 1, 10, 1).setConstant(nan);
+        returns(20, 2) = nan;
+        returns(35, 0) = nan;
+        returns.block(50, 3, 10, 1).setConstant(nan);
+        const MultiEquityPortfolio portfolio = makePortfolio(returns);
+
+        const Eigen::MatrixXd covariance = computePairwiseStatistics(returns, 252.0).covariance;
+        for (Eigen::Index j = 0; j < 4; ++j)
+        {
+            const Eigen::VectorXd column = portfolio.getCovarianceColumn(j);
+            CHECK(!column.hasNaN());
+            CHECK((column - covariance.col(j)).cwiseAbs().maxCoeff() < 1e-15);
+        }
+
+        // a pair without 2 common days has no covariance
+        returns.block(0, 3, 60, 1).setConstant(nan);
+        returns(0, 3) = 0.01;
+        CHECK_THROWS(makePortfolio(returns).getCovarianceColumn(3), std::invalid_argument);
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "covarianceColumnMatchesTheMatrix", covarianceColumnMatchesTheMatrix },
+        { "covarianceColumnHandlesMissingReturns", covarianceColumnHandlesMissingReturns },
+    });
+}
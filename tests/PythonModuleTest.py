@@ -0,0 +1,83 @@
+# Smoke test of the mcvar extension module (built with MCVAR_WITH_PYTHON, ctest puts it on the PYTHONPATH): the results
+# are NumPy views of the buffers of the engine, a Fortran-ordered return matrix is read in place and any other one is
+# copied once, with the same results.
+import math
+import sys
+
+import numpy as np
+
+import mcvar
+
+
+def make_returns(days=250, tickers=3):
+    i = np.arange(days, dtype=np.float64)[:, None]
+    j = np.arange(tickers, dtype=np.float64)[None, :]
+    returns = 0.01 * np.sin(0.7 * i + 1.3 * j) + 0.004 * np.cos(0.31 * i * (j + 1.0))
+    return np.asfortranarray(returns)
+
+
+LAST_PRICES = np.array([200.0, 10.0, 150.0])
+SHARES = [10, 15, 20]
+
+
+def is_engine_view(array):
+    # the memory belongs to the capsule of the engine buffer, not to the array
+    return type(array.base).__name__ == "PyCapsule" and not array.flags.owndata and array.dtype == np.float64
+
+
+def results_are_views_of_the_engine_buffers():
+    engine = mcvar.Engine(make_returns(), LAST_PRICES, SHARES)
+    losses = engine.simulate_losses(10_000, 5, seed=42)
+    assert losses.shape == (10_000,)
+    assert is_engine_view(losses)
+
+    risk = engine.risk(10_000, 5, [0.95, 0.99], seed=42)
+    assert is_engine_view(risk["value_at_risk"]) and is_engine_view(risk["expected_shortfall"])
+    assert risk["exact"]
+    assert np.all(risk["expected_shortfall"] >= risk["value_at_risk"])
+
+
+def fortran_returns_are_read_in_place():
+    returns = make_returns()
+    assert returns.flags.f_contiguous
+    engine = mcvar.Engine(returns, LAST_PRICES, SHARES)
+    assert not engine.returns_copied
+    assert math.isclose(engine.initial_value, float(LAST_PRICES @ SHARES))
+
+
+def other_returns_are_copied_with_the_same_results():
+    returns = make_returns()
+    expected = mcvar.Engine(returns, LAST_PRICES, SHARES).simulate_losses(10_000, 5, seed=7)
+
+    for copied in (np.ascontiguousarray(returns), returns.tolist()):
+        engine = mcvar.Engine(copied, LAST_PRICES, SHARES)
+        assert engine.returns_copied
+        assert np.array_equal(engine.simulate_losses(10_000, 5, seed=7), expected)
+    # converted to float64
+    assert mcvar.Engine(returns.astype(np.float32), LAST_PRICES, SHARES).returns_copied
+
+
+def mismatched_arguments_are_rejected():
+    for returns, shares in ((make_returns(), [10, 15]), (np.zeros(10), SHARES)):
+        try:
+            mcvar.Engine(returns, LAST_PRICES, shares)
+        except ValueError:
+            continue
+        raise AssertionError("mcvar.Engine accepted mismatched arguments")
+
+
+def main():
+    failures = 0
+    for test in (results_are_views_of_the_engine_buffers, fortran_returns_are_read_in_place,
+                 other_returns_are_copied_with_the_same_results, mismatched_arguments_are_rejected):
+        try:
+            test()
+            print("[ OK ]", test.__name__)
+        except Exception as exception:
+            failures += 1
+            print("[FAIL]", test.__name__, repr(exception), file=sys.stderr)
+    return 0 if failures == 0 else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,94 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "Random.h"
+#include "TestCheck.h"
+
+namespace
+{
+    // known answer test of Philox4x32-10 (Random123 kat_vectors: counter and key all ones)
+    void philoxMatchesTheReferenceVector()
+    {
+        const auto output = Random::philox4x32({ 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF }, { 0xFFFFFFFF, 0xFFFFFFFF });
+        CHECK(output[0] == 0x408F276D);
+        CHECK(output[1] == 0x41C83B0E);
+        CHECK(output[2] == 0xA20BC7C6);
+        CHECK(output[3] == 0x6D5451FD);
+    }
+
+    // the scalar calls come from a buffered batch: they must be the values of the bulk generator, in any order
+    void scalarCallsMatchTheBulkGenerator()
+    {
+        constexpr std::size_t paths { 200 };
+        constexpr std::size_t assets { 5 };
+        std::vector<double> bulk(paths * assets);
+        Random::fillNormals(7, 100, paths, 3, 0, assets, bulk.data(), paths);
+
+        for (std::size_t i = paths; i-- > 0; )
+        {
+            for (std::uint32_t asset = 0; asset < assets; ++asset)
+            {
+                CHECK(Random::normal(7, 100 + i, 3, asset) == bulk[asset * paths + i]);
+            }
+        }
+        CHECK(Random::normal(8, 100, 3, 0) != bulk[0]);
+        CHECK(Random::normal(7, 100, 4, 0) != bulk[0]);
+    }
+
+    // a block starting at any path and asset is the matching part of a larger block
+    void blocksDontDependOnTheChunking()
+    {
+        constexpr std::size_t paths { 300 };
+        constexpr std::size_t assets { 6 };
+        std::vector<double> whole(paths * assets);
+        Random::fillNormals(42, 0, paths, 1, 0, assets, whole.data(), paths);
+
+        constexpr std::size_t first_path { 37 };
+        constexpr std::size_t path_count { 101 };
+        constexpr std::uint32_t first_asset { 1 };
+        constexpr std::size_t asset_count { 4 };
+        std::vector<double> part(path_count * asset_count);
+        Random::fillNormals(42, first_path, path_count, 1, first_asset, asset_count, part.data(), path_count);
+
+        for (std::size_t j = 0; j < asset_count; ++j)
+        {
+            for (std::size_t i = 0; i < path_count; ++i)
+            {
+                CHECK(part[j * path_count + i] == whole[(first_asset + j) * paths + first_path + i]);
+            }
+        }
+    }
+
+    void normalsHaveUnitMoments()
+    {
+        constexpr std::size_t count { 1 << 20 };
+        std::vector<double> z0(count);
+        std::vector<double> z1(count);
+        Random::fillNormalPairs(2024, 0, count, 0, 0, z0.data(), z1.data());
+
+        double sum = 0.0;
+        double sum_squares = 0.0;
+        double sum_products = 0.0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            sum += z0[i] + z1[i];
+            sum_squares += z0[i] * z0[i] + z1[i] * z1[i];
+            sum_products += z0[i] * z1[i];
+        }
+        const double n = 2.0 * count;
+        // standard errors: 1/sqrt(n) for the mean, sqrt(2/n) for the variance, 1/sqrt(n/2) for the correlation
+        CHECK_NEAR(sum / n, 0.0, 5.0 / std::sqrt(n));
+        CHECK_NEAR(sum_squares / n, 1.0, 5.0 * std::sqrt(2.0 / n));
+        CHECK_NEAR(sum_products / count, 0.0, 5.0 / std::sqrt(static_cast<double>(count)));
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "philoxMatchesTheReferenceVector", philoxMatchesTheReferenceVector },
+        { "scalarCallsMatchTheBulkGenerator", scalarCallsMatchTheBulkGenerator },
+        { "blocksDontDependOnTheChunking", blocksDontDependOnTheChunking },
+        { "normalsHaveUnitMoments", normalsHaveUnitMoments },
+    });
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <functional>
+#include <random>
+#include <span>
+#include <vector>
+#include "QuantileSketch.h"
+#include "RiskMeasures.h"
+#include "TailCollector.h"
+#include "TestCheck.h"
+
+namespace
+{
+    // heavy-tailed losses of both signs, with some exact zeros
+    std::vector<double> makeLosses(const std::size_t count, const std::uint32_t seed)
+    {
+        std::mt19937 gen(seed);
+        std::student_t_distribution<double> student(3.0);
+        std::vector<double> losses(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            losses[i] = i % 97 == 0 ? 0.0 : 1000.0 * student(gen);
+        }
+        return losses;
+    }
+
+    // every rank of the sketch is within alpha of the exact order statistic, the tails included
+    void sketchRanksAreWithinTheRelativeAccuracy()
+    {
+        for (const double alpha : { 0.01, 0.001 })
+        {
+            std::vector<double> losses = makeLosses(50000, 7);
+            QuantileSketch sketch(alpha);
+            sketch.add(losses);
+            std::sort(losses.begin(), losses.end());
+
+            CHECK(sketch.getCount() == losses.size());
+            for (std::size_t rank = 0; rank < losses.size(); ++rank)
+            {
+                const double exact = losses[rank];
+                CHECK(std::abs(sketch.getValueAtRank(rank) - exact) <= alpha * std::abs(exact) + 1e-12 * std::abs(exact));
+            }
+        }
+    }
+
+    void sketchRiskMeasuresAreWithinTheRelativeAccuracy()
+    {
+        constexpr double alpha { 0.001 };
+        std::vector<double> losses = makeLosses(100000, 11);
+        QuantileSketch sketch(alpha);
+        sketch.add(losses);
+
+        const std::vector<double> levels { 0.95, 0.99, 0.999 };
+        const std::vector<RiskMeasure> exact = computeRiskMeasures(losses, levels);
+        for (std::size_t i = 0; i < levels.size(); ++i)
+        {
+            CHECK(std::abs(sketch.getValueAtRisk(levels[i]) - exact[i].value_at_risk) <= alpha * std::abs(exact[i].value_at_risk));
+            // the tail losses are positive here: mean(|tail|) is the ES
+            CHECK(std::abs(sketch.getExpectedShortfall(levels[i]) - exact[i].expected_shortfall) <= alpha * exact[i].expected_shortfall);
+        }
+    }
+
+    // merging the sketches of the parts gives the sketch of the whole stream
+    void mergedSketchesMatchOneSketch()
+    {
+        const std::vector<double> losses = makeLosses(30000, 3);
+        QuantileSketch whole;
+        whole.add(losses);
+
+        std::vector<QuantileSketch> parts(3);
+        for (std::size_t i = 0; i < losses.size(); ++i)
+        {
+            parts[i % parts.size()].add(losses[i]);
+        }
+        parts[0].merge(parts[1]);
+        parts[0].merge(parts[2]);
+
+        CHECK(parts[0].getCount() == whole.getCount());
+        for (std::uint64_t rank = 0; rank < whole.getCount(); rank += 101)
+        {
+            CHECK(parts[0].getValueAtRank(rank) == whole.getValueAtRank(rank));
+        }
+    }
+
+    // VaR and ES of a full sort: the smallest and the mean of the worst tailCount(confidence, n) losses
+    RiskMeasure sortedRiskMeasure(std::vector<double> losses, const double confidence)
+    {
+        std::sort(losses.begin(), losses.end(), std::greater<>());
+        const std::size_t k = tailCount(confidence, losses.size());
+        double sum = 0.0;
+        for (std::size_t i = 0; i < k; ++i)
+        {
+            sum += losses[i];
+        }
+        return { confidence, losses[k - 1], sum / static_cast<double>(k) };
+    }
+
+    // collectors fed by several workers and merged keep the exact tail of the whole stream
+    void tailCollectorMatchesAFullSort()
+    {
+        const std::vector<double> losses = makeLosses(40000, 5);
+        const std::vector<double> levels { 0.99, 0.95, 0.999 };
+        const std::size_t capacity = tailCount(0.95, losses.size());
+
+        std::vector<TailCollector> collectors(4, TailCollector(capacity));
+        for (std::size_t first = 0; first < losses.size(); first += 1000)
+        {
+            collectors[(first / 1000) % collectors.size()].add(std::span<const double>(losses).subspan(first, 1000));
+        }
+        for (std::size_t i = 1; i < collectors.size(); ++i)
+        {
+            collectors[0].merge(collectors[i]);
+        }
+        CHECK(collectors[0].getCount() == losses.size());
+
+        const std::vector<RiskMeasure> measures = collectors[0].computeRiskMeasures(levels);
+        std::vector<double> copy = losses;
+        const std::vector<RiskMeasure> in_place = computeRiskMeasures(copy, levels);
+        for (std::size_t i = 0; i < levels.size(); ++i)
+        {
+            const RiskMeasure expected = sortedRiskMeasure(losses, levels[i]);
+            CHECK(measures[i].confidence == levels[i]);
+            CHECK(measures[i].value_at_risk == expected.value_at_risk);
+            CHECK_NEAR(measures[i].expected_shortfall, expected.expected_shortfall, 1e-12 * expected.expected_shortfall);
+            CHECK(in_place[i].value_at_risk == expected.value_at_risk);
+            CHECK_NEAR(in_place[i].expected_shortfall, expected.expected_shortfall, 1e-12 * expected.expected_shortfall);
+        }
+
+        // a level below the one of the capacity needs more losses than the collector kept
+        CHECK_THROWS(collectors[0].computeRiskMeasures({ 0.9 }), std::out_of_range);
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "sketchRanksAreWithinTheRelativeAccuracy", sketchRanksAreWithinTheRelativeAccuracy },
+        { "sketchRiskMeasuresAreWithinTheRelativeAccuracy", sketchRiskMeasuresAreWithinTheRelativeAccuracy },
+        { "mergedSketchesMatchOneSketch", mergedSketchesMatchOneSketch },
+        { "tailCollectorMatchesAFullSort", tailCollectorMatchesAFullSort },
+    });
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Minimal test harness: the checks print the failures and the exit code of runTests() tells ctest
+namespace TestCheck
+{
+    inline int failures{ 0 };
+
+    inline void fail(const char* file, const int line, const std::string& message)
+    {
+        ++failures;
+        std::cerr << file << ":" << line << ": " << message << '\n';
+    }
+
+    struct TestCase
+    {
+        std::string name;
+        std::function<void()> body;
+    };
+
+    // run every test case, an exception fails the case: 0 when all the checks passed
+    inline int runTests(const std::vector<TestCase>& tests)
+    {
+        for (const auto& test : tests)
+        {
+            const int failures_before = failures;
+            try
+            {
+                test.body();
+            } catch (const std::exception& exception) {
+                fail(__FILE__, __LINE__, test.name + " threw: " + exception.what());
+            }
+            std::cout << (failures == failures_before ? "[ OK ] " : "[FAIL] ") << test.name << '\n';
+        }
+        return failures == 0 ? 0 : 1;
+    }
+}
+
+#define CHECK(condition) \
+    do { if (!(condition)) { TestCheck::fail(__FILE__, __LINE__, "CHECK(" #condition ") failed"); } } while (false)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do { const double check_actual_ = (actual); const double check_expected_ = (expected); \
+        if (!(std::abs(check_actual_ - check_expected_) <= (tolerance))) { TestCheck::fail(__FILE__, __LINE__, \
+            "CHECK_NEAR(" #actual ", " #expected "): " + std::to_string(check_actual_) + " vs " + std::to_string(check_expected_)); } } while (false)
+
+#define CHECK_THROWS(statement, exception_type) \
+    do { bool check_thrown_ = false; try { statement; } catch (const exception_type&) { check_thrown_ = true; } \
+        if (!check_thrown_) { TestCheck::fail(__FILE__, __LINE__, "CHECK_THROWS(" #statement ", " #exception_type ") failed"); } } while (false)
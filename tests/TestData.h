@@ -0,0 +1,56 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+// Files of the tests, written under the working directory of ctest
+namespace TestData
+{
+    // empty directory of one test case: <test>_data/<name>
+    inline std::string makeDirectory(const std::string& test, const std::string& name)
+    {
+        const std::filesystem::path directory = std::filesystem::path(test + "_data") / name;
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        return directory.string();
+    }
+
+    // "YYYY-MM-DD" of a yyyymmdd date
+    inline std::string formatDate(const std::int32_t date)
+    {
+        char text[16];
+        std::snprintf(text, sizeof(text), "%04d-%02d-%02d", date / 10000, date / 100 % 100, date % 100);
+        return text;
+    }
+
+    // csv file in the format of the loader (Date,Close,Returns,Log Returns): the first close is start_price and
+    // the log returns are the given ones
+    inline void writeReturnCsv(const std::string& path, const std::vector<std::int32_t>& dates, const std::vector<double>& log_returns,
+        const double start_price = 100.0)
+    {
+        std::ofstream file(path);
+        file << "Date,Close,Returns,Log Returns\n" << std::setprecision(17);
+        double close = start_price;
+        for (std::size_t i = 0; i < dates.size(); ++i)
+        {
+            close *= std::exp(log_returns[i]);
+            file << formatDate(dates[i]) << ',' << close << ',' << std::expm1(log_returns[i]) << ',' << log_returns[i] << '\n';
+        }
+    }
+
+    // consecutive calendar days of January-February 2024, enough for the tests
+    inline std::vector<std::int32_t> makeDates(const std::size_t count, const std::size_t first = 0)
+    {
+        std::vector<std::int32_t> dates;
+        for (std::size_t i = first; i < first + count; ++i)
+        {
+            dates.push_back(i < 31 ? 20240101 + static_cast<std::int32_t>(i) : 20240201 + static_cast<std::int32_t>(i - 31));
+        }
+        return dates;
+    }
+}
@@ -0,0 +1,126 @@
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <Eigen/Dense>
+#include "MonteCarloEngine.h"
+#include "ThreadPool.h"
+#include "TestCheck.h"
+
+namespace
+{
+    MultiEquityEngine makeEngine()
+    {
+        Eigen::MatrixXd covariance(3, 3);
+        covariance << 0.04, 0.01, 0.0,
+                      0.01, 0.09, 0.02,
+                      0.0, 0.02, 0.0625;
+        Eigen::VectorXd drift(3);
+        drift << 0.0002, 0.0001, 0.0003;
+        Eigen::VectorXd last_prices(3);
+        last_prices << 200.0, 10.0, 150.0;
+        return MultiEquityEngine(Eigen::MatrixXd(Eigen::LLT<Eigen::MatrixXd>(covariance).matrixL()), drift, last_prices, {10, 15, 20});
+    }
+
+    void parallelForRunsEveryIndexOnce()
+    {
+        ThreadPool pool(4);
+        std::vector<std::atomic<int>> runs(1000);
+        pool.parallelFor(runs.size(), [&runs](const std::size_t i) { ++runs[i]; });
+
+        for (const auto& run : runs)
+        {
+            CHECK(run.load() == 1);
+        }
+    }
+
+    void parallelForRethrowsTheException()
+    {
+        ThreadPool pool(2);
+        CHECK_THROWS(pool.parallelFor(100, [](const std::size_t i)
+        {
+            if (i == 42)
+            {
+                throw std::runtime_error("task 42");
+            }
+        }), std::runtime_error);
+    }
+
+    // tasks submitted from several threads outside the pool while the workers steal them: every task runs once and
+    // the destructor returns once the queues are drained
+    void submitFromSeveralThreadsRunsEveryTask()
+    {
+        std::atomic<int> runs{ 0 };
+        {
+            ThreadPool pool(3);
+            std::vector<std::thread> producers;
+            for (int p = 0; p < 4; ++p)
+            {
+                producers.emplace_back([&pool, &runs]
+                {
+                    for (int i = 0; i < 5000; ++i)
+                    {
+                        pool.submit([&runs] { ++runs; });
+                    }
+                });
+            }
+            for (auto& producer : producers)
+            {
+                producer.join();
+            }
+        }
+        CHECK(runs.load() == 20000);
+    }
+
+    // two threads outside the pool share the worker index getThreadCount(): each of them must only run the work of
+    // its own call, otherwise both write the same per-worker collector
+    void concurrentCallersGetTheirOwnResults()
+    {
+        ThreadPool pool(4);
+        const MultiEquityEngine engine = makeEngine();
+
+        SimulationConfig config;
+        config.simulations = 200000;
+        config.trading_days = 5;
+        config.chunk_size = 1024;
+        config.seed = 11;
+        const RiskReport expected = engine.simulateRisk(config, pool, {0.95, 0.99});
+
+        std::vector<RiskReport> reports(2);
+        std::vector<std::thread> callers;
+        for (std::size_t c = 0; c < reports.size(); ++c)
+        {
+            callers.emplace_back([&, c]
+            {
+                for (int repeat = 0; repeat < 5; ++repeat)
+                {
+                    reports[c] = engine.simulateRisk(config, pool, {0.95, 0.99});
+                }
+            });
+        }
+        for (auto& caller : callers)
+        {
+            caller.join();
+        }
+
+        for (const auto& report : reports)
+        {
+            CHECK(report.measures.size() == expected.measures.size());
+            for (std::size_t i = 0; i < report.measures.size() && i < expected.measures.size(); ++i)
+            {
+                CHECK(report.measures[i].value_at_risk == expected.measures[i].value_at_risk);
+                CHECK(report.measures[i].expected_shortfall == expected.measures[i].expected_shortfall);
+            }
+        }
+    }
+}
+
+int main()
+{
+    return TestCheck::runTests({
+        { "parallelForRunsEveryIndexOnce", parallelForRunsEveryIndexOnce },
+        { "parallelForRethrowsTheException", parallelForRethrowsTheException },
+        { "submitFromSeveralThreadsRunsEveryTask", submitFromSeveralThreadsRunsEveryTask },
+        { "concurrentCallersGetTheirOwnResults", concurrentCallersGetTheirOwnResults },
+    });
+}
@@ -0,0 +1,28 @@
+# Stand-in provider of the import plugin for ImportPluginTest (MCVAR_PROVIDER_MODULE=canned_provider): canned series
+# instead of a yfinance download, no network.
+import numpy as np
+
+# fetch() calls since the module was imported: it only keeps growing if the interpreter and the module stay loaded
+fetch_count = 0
+
+# ticker: (log_returns, close_prices) of the same days
+CANNED = {
+    # float64 arrays: read in place by the plugin
+    "AAA": (np.array([0.01, -0.02, 0.005]), np.array([101.0, 99.0, 99.5])),
+    # lists of floats: converted by the plugin
+    "BBB": ([0.0, 0.03], [50.0, 51.5]),
+}
+
+
+def fetch(tickers):
+    global fetch_count
+    fetch_count += 1
+
+    series = {}
+    for ticker in tickers:
+        if ticker == "COUNT":
+            series[ticker] = ([float(fetch_count)], [float(fetch_count)])
+        else:
+            # an unknown ticker raises KeyError: the plugin reports it as an error
+            series[ticker] = CANNED[ticker]
+    return series